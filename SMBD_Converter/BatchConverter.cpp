@@ -0,0 +1,336 @@
+#include "BatchConverter.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+#include "ConversionContext.h"
+#include "FunctionsAndDefines.h"
+#include "GMAConverter.h"
+#include "InputSource.h"
+#include "LZCompression.h"
+#include "RawLZConverter.h"
+#include "StageViews.h"
+#include "TPLConverter.h"
+#include "WorkPool.h"
+
+static bool endsWith(const std::string &text, const char *suffix) {
+	size_t length = strlen(suffix);
+	if (text.length() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; ++i) {
+		char c = text[text.length() - length + i];
+		if (c >= 'A' && c <= 'Z') {
+			c = c - 'A' + 'a';
+		}
+		if (c != suffix[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Returns false if path doesn't exist
+static bool statPath(const std::string &path, bool *isDirectory, uint64_t *size) {
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path.c_str(), &info) != 0) {
+		return false;
+	}
+	*isDirectory = (info.st_mode & _S_IFDIR) != 0;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return false;
+	}
+	*isDirectory = S_ISDIR(info.st_mode);
+#endif
+	*size = (uint64_t)info.st_size;
+	return true;
+}
+
+static void listDirectory(const std::string &directory, std::vector<std::string> *entries) {
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	do {
+		if (strcmp(data.cFileName, ".") != 0 && strcmp(data.cFileName, "..") != 0) {
+			entries->push_back(directory + "\\" + data.cFileName);
+		}
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+#else
+	DIR *dir = opendir(directory.c_str());
+	if (dir == NULL) {
+		return;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+			entries->push_back(directory + "/" + entry->d_name);
+		}
+	}
+	closedir(dir);
+#endif
+	// Directory order isn't defined, keep runs repeatable
+	std::sort(entries->begin(), entries->end());
+}
+
+// Checks for a GCMF (SMB2) or FMCG (SMBD) model header where the first model in the gma should be
+static bool hasGMAMagic(FILE *file, const uint8_t *header, size_t headerSize, uint64_t size) {
+	if (headerSize < 16) {
+		return false;
+	}
+	// Same game check as convertGMA
+	bool little = readBigShort(header) != 0;
+	uint32_t numModels = little ? readLittleInt(header) : readBigInt(header);
+	uint32_t modelBase = little ? readLittleInt(&header[4]) : readBigInt(&header[4]);
+
+	// Skip over empty model slots (offset -1) in the first few entries
+	for (uint32_t i = 0; i < numModels && 16 + i * 8 <= headerSize; ++i) {
+		uint32_t modelOffset = little ? readLittleInt(&header[8 + i * 8]) : readBigInt(&header[8 + i * 8]);
+		if (modelOffset == 0xFFFFFFFF) {
+			continue;
+		}
+		uint64_t position = (uint64_t)modelBase + modelOffset;
+		uint8_t magic[4];
+		if (position + 4 > size || fseek(file, (long)position, SEEK_SET) != 0 || fread(magic, 1, 4, file) != 4) {
+			return false;
+		}
+		return memcmp(magic, "GCMF", 4) == 0 || memcmp(magic, "FMCG", 4) == 0;
+	}
+	return false;
+}
+
+int classifyFile(const std::string &path, uint64_t size) {
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		return BATCH_FILE_UNKNOWN;
+	}
+	uint8_t header[0x40];
+	size_t headerSize = fread(header, 1, sizeof(header), file);
+
+	int type = BATCH_FILE_UNKNOWN;
+	uint32_t compressedSize;
+	uint32_t dataSize;
+	if (headerSize >= 4 && memcmp(header, "XTPL", 4) == 0) {
+		type = BATCH_FILE_TPL;
+	}
+	// The lz header's compressed size is the size of the whole file
+	else if (readLZHeader(header, headerSize, &compressedSize, &dataSize) == 0 && compressedSize == size && dataSize >= 0x89C) {
+		type = BATCH_FILE_LZ;
+	}
+	else if (hasGMAMagic(file, header, headerSize, size)) {
+		type = BATCH_FILE_GMA;
+	}
+	// SMB2 tpls and raw stages have no magic
+	else if (endsWith(path, ".tpl")) {
+		type = BATCH_FILE_TPL;
+	}
+	else if (endsWith(path, ".raw") || endsWith(path, "mb2") || endsWith(path, "mbd")) {
+		type = size >= 0x89C ? BATCH_FILE_RAWLZ : BATCH_FILE_UNKNOWN;
+	}
+	fclose(file);
+	return type;
+}
+
+static void collectFiles(const std::string &path, bool explicitPath, std::vector<BatchFile> *files) {
+	bool isDirectory;
+	uint64_t size;
+	if (!statPath(path, &isDirectory, &size)) {
+		if (explicitPath) {
+			printf("ERROR: File not found: %s\n", path.c_str());
+		}
+		return;
+	}
+
+	if (isDirectory) {
+		std::vector<std::string> entries;
+		listDirectory(path, &entries);
+		for (size_t i = 0; i < entries.size(); ++i) {
+			collectFiles(entries[i], false, files);
+		}
+		return;
+	}
+
+	// Don't convert output from a previous run again
+	if (!explicitPath && (endsWith(path, ".smb2") || endsWith(path, ".smbd") || endsWith(path, ".smb2.lz") || endsWith(path, ".smbd.lz"))) {
+		return;
+	}
+
+	BatchFile file;
+	file.path = path;
+	file.size = size;
+	file.type = classifyFile(path, size);
+	if (file.type == BATCH_FILE_UNKNOWN) {
+		if (explicitPath) {
+			printf("WARNING: Unknown file type: %s\n", path.c_str());
+		}
+		return;
+	}
+	files->push_back(file);
+}
+
+void collectBatchFiles(const std::string &path, std::vector<BatchFile> *files) {
+	collectFiles(path, true, files);
+}
+
+static bool convertBatchFile(const BatchFile *file, const BatchOptions *options, WorkPool *pool, StagePlanCache *plans) {
+	ConversionContext context;
+	initConversionContext(&context, file->path.c_str());
+	context.pool = pool;
+	context.plans = plans;
+	context.recompress = options->recompress;
+	context.compressionLevel = options->compressionLevel;
+	context.inPlace = options->inPlace;
+
+	if (loadInputFile(&context)) {
+		int result = -1;
+		switch (file->type) {
+		case BATCH_FILE_TPL:
+			result = convertTPL(&context);
+			break;
+		case BATCH_FILE_GMA:
+			result = convertGMA(&context);
+			break;
+		case BATCH_FILE_LZ:
+			result = convertLZ(&context);
+			break;
+		case BATCH_FILE_RAWLZ:
+			result = convertRawLZ(&context);
+			break;
+		}
+
+		if (result == 0) {
+			std::string outfileName = convertedFilename(&context);
+			if (file->type == BATCH_FILE_LZ && context.recompress) {
+				outfileName += ".lz";
+			}
+			if (writeOutputFile(&context, outfileName, outputData(&context), outputSize(&context))) {
+				addDiagnostic(&context, DIAGNOSTIC_INFO, "Converted %s -> %s", file->path.c_str(), outfileName.c_str());
+			}
+		}
+	}
+	printDiagnostics(&context);
+	return !hasErrors(&context);
+}
+
+static bool largerFile(const BatchFile &a, const BatchFile &b) {
+	return a.size > b.size;
+}
+
+int convertBatch(const std::vector<std::string> &paths, const BatchOptions *options) {
+	std::vector<BatchFile> files;
+	for (size_t i = 0; i < paths.size(); ++i) {
+		collectBatchFiles(paths[i], &files);
+	}
+
+	// The biggest files take the longest, start them first so they don't end up running alone at the end
+	std::stable_sort(files.begin(), files.end(), largerFile);
+
+	WorkPool *pool = createWorkPool(options->threadCount);
+	printf("Converting %d files on %d threads\n", (int)files.size(), workPoolThreadCount(pool));
+
+	// Stages exported the same way share their plan
+	StagePlanCache plans;
+	clearStagePlanCache(&plans);
+
+	std::atomic<int> failed(0);
+	for (size_t i = 0; i < files.size(); ++i) {
+		const BatchFile *file = &files[i];
+		addWork(pool, [file, options, pool, &plans, &failed]() {
+			if (!convertBatchFile(file, options, pool, &plans)) {
+				++failed;
+			}
+		});
+	}
+	destroyWorkPool(pool);
+
+	printf("Finished Converting %d files (%d failed)\n", (int)files.size(), (int)failed);
+	if (plans.hits != 0) {
+		printf("%d of %d stages had the same structure as an earlier one\n", (int)plans.hits, (int)(plans.hits + plans.misses));
+	}
+	return failed;
+}
+
+// A list count that can't be right for a file of size bytes (ie: a compressed model instead of a stage)
+template <template <typename> class E>
+static bool badStageList(const ItemView<E> &item, uint32_t size) {
+	return item.number < 0 || (uint32_t)item.number > size || item.offset >= size;
+}
+
+template <template <typename> class E>
+static bool printStageCounts(const std::string &path, const StageImage *header, uint32_t size) {
+	const StageHeaderView<E> *view = viewStageHeader<E>(header);
+	if (view == NULL || badStageList(view->collisionFields, size) || badStageList(view->goals, size) || badStageList(view->bumpers, size)
+		|| badStageList(view->bananas, size) || badStageList(view->wormholes, size)) {
+		return false;
+	}
+	printf("%s\t%s\t%u\t%d\t%d\t%d\t%d\t%d\n", path.c_str(), isSMBDImage(header) ? "SMBD" : "SMB2", size,
+		(int)view->collisionFields.number, (int)view->goals.number, (int)view->bananas.number, (int)view->bumpers.number, (int)view->wormholes.number);
+	return true;
+}
+
+// Only the stage header is read (and decoded for an .lz), the rest of the file is never touched
+static bool catalogFile(const BatchFile *file) {
+	InputSource input;
+	if (!openInputSource(&input, file->path.c_str())) {
+		printf("ERROR: File not found: %s\n", file->path.c_str());
+		return false;
+	}
+	// Don't read ahead through the whole file for the first few KB
+	adviseInputSource(&input, INPUT_ACCESS_SPARSE);
+
+	uint8_t headerData[0x89C];
+	StageImage header = { input.data, 0 };
+	uint32_t size = (uint32_t)input.size;
+	if (file->type == BATCH_FILE_LZ) {
+		uint32_t csize;
+		int decoded = readLZHeader(input.data, input.size, &csize, &size);
+		if (decoded == 0) {
+			decoded = decompressLZPrefix(input.data, input.size, headerData, sizeof(headerData));
+		}
+		header.data = headerData;
+		header.size = decoded > 0 ? (uint32_t)decoded : 0;
+	}
+	else {
+		header.size = size < sizeof(headerData) ? size : (uint32_t)sizeof(headerData);
+	}
+
+	bool stage = isSMBDImage(&header) ? printStageCounts<LittleEndian>(file->path, &header, size) : printStageCounts<BigEndian>(file->path, &header, size);
+	closeInputSource(&input);
+	if (!stage) {
+		printf("WARNING: Not a stage: %s\n", file->path.c_str());
+	}
+	return stage;
+}
+
+int catalogStages(const std::vector<std::string> &paths) {
+	std::vector<BatchFile> files;
+	for (size_t i = 0; i < paths.size(); ++i) {
+		collectBatchFiles(paths[i], &files);
+	}
+
+	printf("file\tgame\tsize\tcollision fields\tgoals\tbananas\tbumpers\twormholes\n");
+	int stages = 0;
+	for (size_t i = 0; i < files.size(); ++i) {
+		if ((files[i].type == BATCH_FILE_LZ || files[i].type == BATCH_FILE_RAWLZ) && catalogFile(&files[i])) {
+			++stages;
+		}
+	}
+	return stages;
+}
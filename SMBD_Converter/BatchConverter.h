@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// File types found by looking at their content
+#define BATCH_FILE_UNKNOWN 0
+#define BATCH_FILE_TPL 1
+#define BATCH_FILE_GMA 2
+#define BATCH_FILE_LZ 3
+#define BATCH_FILE_RAWLZ 4
+
+typedef struct {
+	std::string path;
+	uint64_t size;
+	int type;
+}BatchFile;
+
+typedef struct {
+	// 0 = one thread per hardware thread
+	int threadCount;
+	// Recompress converted .lz stages
+	bool recompress;
+	int compressionLevel;
+	// Convert stages over the loaded file instead of into a second buffer
+	bool inPlace;
+}BatchOptions;
+
+// Works out what a file is from its magic (XTPL, GCMF/FMCG, lz header), falling back to the extension (tpl, gma, lz, raw)
+int classifyFile(const std::string &path, uint64_t size);
+
+// Adds path (or every file under it if it's a directory) to files
+// Files inside directories that are converter output (.smb2/.smbd) or not convertible are skipped
+void collectBatchFiles(const std::string &path, std::vector<BatchFile> *files);
+
+// Converts every file under paths on a thread pool, largest first
+// Returns the number of files that failed
+int convertBatch(const std::vector<std::string> &paths, const BatchOptions *options);
+
+// Prints the game, size and item counts (collision fields, goals, bananas, bumpers, wormholes) of every stage under paths
+// Only the stage header is decoded, so cataloging a directory of .lz stages costs a fraction of decompressing them
+// Returns the number of stages printed
+int catalogStages(const std::vector<std::string> &paths);
@@ -0,0 +1,96 @@
+#include "ConversionContext.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <string.h>
+#include "FunctionsAndDefines.h"
+
+void initConversionContext(ConversionContext *context, const char *filename) {
+	context->filename = filename;
+	context->sourceGame = GAME_UNKNOWN;
+	context->targetGame = GAME_UNKNOWN;
+	initInputSource(&context->input);
+	context->output.clear();
+	context->convertedInPlace = false;
+	context->recompress = false;
+	context->compressionLevel = 0;
+	context->inPlace = false;
+	context->pool = NULL;
+	context->plans = NULL;
+	context->diagnostics.clear();
+}
+
+void addDiagnostic(ConversionContext *context, int level, const char *format, ...) {
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	Diagnostic diagnostic;
+	diagnostic.level = level;
+	diagnostic.message = message;
+	context->diagnostics.push_back(diagnostic);
+}
+
+bool hasErrors(const ConversionContext *context) {
+	for (size_t i = 0; i < context->diagnostics.size(); ++i) {
+		if (context->diagnostics[i].level == DIAGNOSTIC_ERROR) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void printDiagnostics(const ConversionContext *context) {
+	std::string text;
+	for (size_t i = 0; i < context->diagnostics.size(); ++i) {
+		const Diagnostic &diagnostic = context->diagnostics[i];
+		if (diagnostic.level == DIAGNOSTIC_ERROR) {
+			text += "ERROR: ";
+		}
+		else if (diagnostic.level == DIAGNOSTIC_WARNING) {
+			text += "WARNING: ";
+		}
+		text += diagnostic.message;
+		text += '\n';
+	}
+	fputs(text.c_str(), stdout);
+}
+
+bool loadInputFile(ConversionContext *context) {
+	bool opened = context->inPlace ? openWritableInputSource(&context->input, context->filename.c_str())
+		: openInputSource(&context->input, context->filename.c_str());
+	if (!opened) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Error opening file: %s", context->filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+const uint8_t* outputData(const ConversionContext *context) {
+	return context->convertedInPlace ? context->input.data : context->output.data();
+}
+
+size_t outputSize(const ConversionContext *context) {
+	return context->convertedInPlace ? context->input.size : context->output.size();
+}
+
+bool writeOutputFile(ConversionContext *context, const std::string &filename, const uint8_t *data, size_t size) {
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Failed to open file: %s (%s)", filename.c_str(), strerror(errno));
+		return false;
+	}
+	fwrite(data, 1, size, file);
+	fclose(file);
+	return true;
+}
+
+std::string convertedFilename(const ConversionContext *context) {
+	return context->filename + (context->targetGame == SMB2 ? ".smb2" : ".smbd");
+}
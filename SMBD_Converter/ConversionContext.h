@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "InputSource.h"
+#include "WorkPool.h"
+#include "StagePlan.h"
+
+// Source/target game when it isn't known yet (detected from the file)
+#define GAME_UNKNOWN -1
+
+// Diagnostic levels
+#define DIAGNOSTIC_INFO 0
+#define DIAGNOSTIC_WARNING 1
+#define DIAGNOSTIC_ERROR 2
+
+typedef struct {
+	int level;
+	std::string message;
+}Diagnostic;
+
+// Everything a single conversion works with
+// Converters only touch the context they are given, so conversions on different contexts can run at the same time
+typedef struct {
+	// File being converted (used for messages and output names)
+	std::string filename;
+
+	// Direction
+	// sourceGame can be set to skip detection, targetGame is filled in by the converter
+	int sourceGame;
+	int targetGame;
+
+	// Buffers
+	InputSource input;
+	std::vector<uint8_t> output;
+	// The result was written over input instead of into output (see outputData)
+	bool convertedInPlace;
+
+	// Options
+	bool recompress;
+	int compressionLevel;
+	// Convert raw lz stages inside input instead of into a second buffer (loadInputFile maps the file copy on write)
+	bool inPlace;
+	// Pool for converting parts of a file in parallel (NULL = convert on the calling thread)
+	WorkPool *pool;
+	// Plans of raw lz stages converted before, stages with the same structure aren't walked again (NULL = walk every stage)
+	StagePlanCache *plans;
+
+	// Messages from the conversion, printed by the caller when it's done
+	std::vector<Diagnostic> diagnostics;
+}ConversionContext;
+
+void initConversionContext(ConversionContext *context, const char *filename);
+
+// printf style message
+void addDiagnostic(ConversionContext *context, int level, const char *format, ...);
+
+// True if an error was reported
+bool hasErrors(const ConversionContext *context);
+
+// Prints every diagnostic in one write so messages from different threads don't interleave
+void printDiagnostics(const ConversionContext *context);
+
+// Maps context->filename as context->input (read into memory if it can't be mapped)
+bool loadInputFile(ConversionContext *context);
+
+// The converted file (input when it was converted in place, output otherwise)
+const uint8_t* outputData(const ConversionContext *context);
+size_t outputSize(const ConversionContext *context);
+
+// Writes size bytes of data to filename
+bool writeOutputFile(ConversionContext *context, const std::string &filename, const uint8_t *data, size_t size);
+
+// Name of the converted file (<filename>.smb2/.smbd)
+std::string convertedFilename(const ConversionContext *context);
@@ -0,0 +1,475 @@
+#include "FunctionsAndDefines.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include "StageSchemas.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SWAP_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows any intrinsic without compiler flags
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#else
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Byte orders within a 16 byte block for arrays of ints/shorts
+static const uint8_t intMask[32] = {
+	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+static const uint8_t shortMask[32] = {
+	1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+	1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+};
+
+int detectSwapKernel() {
+#ifdef SWAP_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool ssse3 = (info[2] & (1 << 9)) != 0;
+	// AVX needs the OS to save the ymm registers (OSXSAVE + xgetbv)
+	bool avxOS = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	bool avx2 = false;
+	if (avxOS && maxLeaf >= 7) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	bool ssse3 = __builtin_cpu_supports("ssse3") != 0;
+	bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+	if (avx2) return SWAP_KERNEL_AVX2;
+	if (ssse3) return SWAP_KERNEL_SSSE3;
+#endif
+	return SWAP_KERNEL_PORTABLE;
+}
+
+// Conversions run on several threads, every thread detects the same value so relaxed is enough
+static std::atomic<int> swapKernel(-1);
+
+int getSwapKernel() {
+	int kernel = swapKernel.load(std::memory_order_relaxed);
+	if (kernel < 0) {
+		kernel = detectSwapKernel();
+		swapKernel.store(kernel, std::memory_order_relaxed);
+	}
+	return kernel;
+}
+
+void setSwapKernel(int kernel) {
+	int best = detectSwapKernel();
+	swapKernel.store((kernel < SWAP_KERNEL_PORTABLE) ? SWAP_KERNEL_PORTABLE : (kernel > best ? best : kernel), std::memory_order_relaxed);
+}
+
+#ifdef SWAP_X86
+
+// Shuffles length bytes (a multiple of 16) with masks cycling through maskCount 16 byte masks
+// masks must have maskCount + 1 entries (the first repeated) so the AVX2 loop can load two at a time
+TARGET_SSSE3 static size_t shuffleSSSE3(const uint8_t *input, uint8_t *output, size_t length, const uint8_t *masks, uint32_t maskCount) {
+	uint32_t mask = 0;
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i shuffle = _mm_loadu_si128((const __m128i *)&masks[mask * 16]);
+		__m128i data = _mm_loadu_si128((const __m128i *)&input[i]);
+		_mm_storeu_si128((__m128i *)&output[i], _mm_shuffle_epi8(data, shuffle));
+		if (++mask == maskCount) mask = 0;
+	}
+	return i;
+}
+
+TARGET_AVX2 static size_t shuffleAVX2(const uint8_t *input, uint8_t *output, size_t length, const uint8_t *masks, uint32_t maskCount) {
+	uint32_t mask = 0;
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		// vpshufb shuffles each 16 byte lane on its own, so this is the same as two SSSE3 shuffles
+		__m256i shuffle = _mm256_loadu_si256((const __m256i *)&masks[mask * 16]);
+		__m256i data = _mm256_loadu_si256((const __m256i *)&input[i]);
+		_mm256_storeu_si256((__m256i *)&output[i], _mm256_shuffle_epi8(data, shuffle));
+		mask = (mask + 2) % maskCount;
+	}
+	// One 16 byte block may be left
+	if (i + 16 <= length) {
+		__m128i shuffle = _mm_loadu_si128((const __m128i *)&masks[mask * 16]);
+		__m128i data = _mm_loadu_si128((const __m128i *)&input[i]);
+		_mm_storeu_si128((__m128i *)&output[i], _mm_shuffle_epi8(data, shuffle));
+		i += 16;
+	}
+	return i;
+}
+
+#endif
+
+// Shuffles as many whole 16 byte blocks as the current kernel can
+// Returns how many bytes were done (0 for the portable kernel)
+static size_t shuffleBlocks(const uint8_t *input, uint8_t *output, size_t length, const uint8_t *masks, uint32_t maskCount) {
+#ifdef SWAP_X86
+	switch (getSwapKernel()) {
+	case SWAP_KERNEL_AVX2:
+		return shuffleAVX2(input, output, length, masks, maskCount);
+	case SWAP_KERNEL_SSSE3:
+		return shuffleSSSE3(input, output, length, masks, maskCount);
+	}
+#endif
+	return 0;
+}
+
+void swapInts(const uint8_t *input, uint8_t *output, size_t count) {
+	size_t length = count * 4;
+	size_t done = shuffleBlocks(input, output, length, intMask, 1);
+	for (; done < length; done += 4) {
+		storeInt(&output[done], swapInt(loadInt(&input[done])));
+	}
+}
+
+void swapShorts(const uint8_t *input, uint8_t *output, size_t count) {
+	size_t length = count * 2;
+	size_t done = shuffleBlocks(input, output, length, shortMask, 1);
+	for (; done < length; done += 2) {
+		storeShort(&output[done], swapShort(loadShort(&input[done])));
+	}
+}
+
+#ifdef SWAP_X86
+
+// SSE2 has no unsigned 16 bit max, flipping the sign bit makes the signed one work
+TARGET_SSSE3 static size_t scanShortListSSE2(const uint8_t *data, size_t count, bool bigEndian, uint16_t *maxValue) {
+	const __m128i end = _mm_set1_epi16(-1);
+	const __m128i sign = _mm_set1_epi16((short)0x8000);
+	__m128i best = _mm_set1_epi16((short)0x8000);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i values = _mm_loadu_si128((const __m128i *)&data[i * 2]);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(values, end)) != 0) break;
+		if (bigEndian == hostIsLittleEndian()) {
+			values = _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+		}
+		best = _mm_max_epi16(best, _mm_xor_si128(values, sign));
+	}
+
+	uint16_t lanes[8];
+	_mm_storeu_si128((__m128i *)lanes, _mm_xor_si128(best, sign));
+	uint16_t max = 0;
+	for (int lane = 0; lane < 8; ++lane) {
+		if (lanes[lane] > max) max = lanes[lane];
+	}
+	*maxValue = max;
+	return i;
+}
+
+TARGET_AVX2 static size_t scanShortListAVX2(const uint8_t *data, size_t count, bool bigEndian, uint16_t *maxValue) {
+	const __m256i end = _mm256_set1_epi16(-1);
+	const __m256i swap = _mm256_loadu_si256((const __m256i *)shortMask);
+	__m256i best = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i values = _mm256_loadu_si256((const __m256i *)&data[i * 2]);
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(values, end)) != 0) break;
+		if (bigEndian == hostIsLittleEndian()) {
+			values = _mm256_shuffle_epi8(values, swap);
+		}
+		best = _mm256_max_epu16(best, values);
+	}
+
+	uint16_t lanes[16];
+	_mm256_storeu_si256((__m256i *)lanes, best);
+	uint16_t max = 0;
+	for (int lane = 0; lane < 16; ++lane) {
+		if (lanes[lane] > max) max = lanes[lane];
+	}
+	*maxValue = max;
+	return i;
+}
+
+#endif
+
+size_t scanShortList(const uint8_t *data, size_t count, bool bigEndian, uint16_t *maxValue) {
+	// Whole blocks without the end marker first, then the rest one at a time
+	size_t i = 0;
+	uint16_t max = 0;
+#ifdef SWAP_X86
+	switch (getSwapKernel()) {
+	case SWAP_KERNEL_AVX2:
+		i = scanShortListAVX2(data, count, bigEndian, &max);
+		break;
+	case SWAP_KERNEL_SSSE3:
+		i = scanShortListSSE2(data, count, bigEndian, &max);
+		break;
+	}
+#endif
+	for (; i < count; ++i) {
+		uint16_t value = bigEndian ? readBigShort(&data[i * 2]) : readLittleShort(&data[i * 2]);
+		if (value == 0xFFFF) break;
+		if (value > max) max = value;
+	}
+	*maxValue = max;
+	return i;
+}
+
+// Second 16 bytes of a collision triangle: 2 ints then 4 shorts
+static const uint8_t triangleMixedMask[16] = {
+	3, 2, 1, 0, 7, 6, 5, 4, 9, 8, 11, 10, 13, 12, 15, 14
+};
+
+#ifdef SWAP_X86
+
+TARGET_SSSE3 static void swapCollisionTrianglesSSSE3(const uint8_t *input, uint8_t *output, size_t count) {
+	const __m128i ints = _mm_loadu_si128((const __m128i *)intMask);
+	const __m128i mixed = _mm_loadu_si128((const __m128i *)triangleMixedMask);
+	for (size_t i = 0; i < count; ++i) {
+		const __m128i *in = (const __m128i *)&input[i * COLLISION_TRIANGLE_SIZE];
+		__m128i *out = (__m128i *)&output[i * COLLISION_TRIANGLE_SIZE];
+		__m128i a = _mm_loadu_si128(in);
+		__m128i b = _mm_loadu_si128(in + 1);
+		__m128i c = _mm_loadu_si128(in + 2);
+		__m128i d = _mm_loadu_si128(in + 3);
+		_mm_storeu_si128(out, _mm_shuffle_epi8(a, ints));
+		_mm_storeu_si128(out + 1, _mm_shuffle_epi8(b, mixed));
+		_mm_storeu_si128(out + 2, _mm_shuffle_epi8(c, ints));
+		_mm_storeu_si128(out + 3, _mm_shuffle_epi8(d, ints));
+	}
+}
+
+TARGET_AVX2 static void swapCollisionTrianglesAVX2(const uint8_t *input, uint8_t *output, size_t count) {
+	// First half has the shorts in its upper lane, second half is all ints
+	const __m256i first = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)intMask)), _mm_loadu_si128((const __m128i *)triangleMixedMask), 1);
+	const __m256i second = _mm256_loadu_si256((const __m256i *)intMask);
+	for (size_t i = 0; i < count; ++i) {
+		const __m256i *in = (const __m256i *)&input[i * COLLISION_TRIANGLE_SIZE];
+		__m256i *out = (__m256i *)&output[i * COLLISION_TRIANGLE_SIZE];
+		__m256i a = _mm256_loadu_si256(in);
+		__m256i b = _mm256_loadu_si256(in + 1);
+		_mm256_storeu_si256(out, _mm256_shuffle_epi8(a, first));
+		_mm256_storeu_si256(out + 1, _mm256_shuffle_epi8(b, second));
+	}
+}
+
+#endif
+
+void swapCollisionTriangles(const uint8_t *input, uint8_t *output, size_t count) {
+#ifdef SWAP_X86
+	switch (getSwapKernel()) {
+	case SWAP_KERNEL_AVX2:
+		swapCollisionTrianglesAVX2(input, output, count);
+		return;
+	case SWAP_KERNEL_SSSE3:
+		swapCollisionTrianglesSSSE3(input, output, count);
+		return;
+	}
+#endif
+	for (size_t i = 0; i < count; ++i) {
+		const uint8_t *in = &input[i * COLLISION_TRIANGLE_SIZE];
+		uint8_t *out = &output[i * COLLISION_TRIANGLE_SIZE];
+		for (uint32_t offset = 0; offset < COLLISION_TRIANGLE_SIZE; offset += 4) {
+			if (offset == 0x18 || offset == 0x1C) {
+				storeShort(&out[offset], swapShort(loadShort(&in[offset])));
+				storeShort(&out[offset + 2], swapShort(loadShort(&in[offset + 2])));
+			}
+			else {
+				storeInt(&out[offset], swapInt(loadInt(&in[offset])));
+			}
+		}
+	}
+}
+
+bool buildRecordLayout(RecordLayout *layout, const uint8_t *fieldWidths, uint32_t fieldCount) {
+	uint32_t size = 0;
+	bool aligned = true;
+	for (uint32_t i = 0; i < fieldCount; ++i) {
+		uint8_t width = fieldWidths[i];
+		if (width != 1 && width != 2 && width != 4) return false;
+		if (size % width != 0) aligned = false;
+		size += width;
+		if (size > RECORD_MAX_SIZE) return false;
+	}
+	if (size == 0) return false;
+
+	layout->size = size;
+	layout->fieldCount = fieldCount;
+	memcpy(layout->fieldWidths, fieldWidths, fieldCount);
+
+	// Fields can only be shuffled if none of them cross a 16 byte block in any record
+	// That's the case when every field (and so the record size) is aligned to its width
+	for (uint32_t i = 0; i < fieldCount; ++i) {
+		if (size % fieldWidths[i] != 0) aligned = false;
+	}
+
+	// Records line up with the 16 byte blocks again after lcm(size, 16) bytes
+	uint32_t a = size, b = 16;
+	while (b != 0) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	uint32_t period = size / a * 16;
+	layout->maskCount = (aligned && period / 16 <= RECORD_MAX_SIZE / 2) ? period / 16 : 0;
+
+	// Byte order within one record
+	uint8_t order[RECORD_MAX_SIZE];
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < fieldCount; ++i) {
+		for (uint32_t j = 0; j < fieldWidths[i]; ++j) {
+			order[offset + j] = (uint8_t)(offset + fieldWidths[i] - 1 - j);
+		}
+		offset += fieldWidths[i];
+	}
+
+	for (uint32_t i = 0; i < layout->maskCount * 16; ++i) {
+		uint32_t inRecord = i % size;
+		uint32_t source = i - inRecord + order[inRecord];
+		layout->masks[i] = (uint8_t)(source % 16);
+	}
+	if (layout->maskCount != 0) {
+		memcpy(&layout->masks[layout->maskCount * 16], layout->masks, 16);
+	}
+	return true;
+}
+
+void swapRecords(const RecordLayout *layout, const uint8_t *input, uint8_t *output, size_t count) {
+	size_t length = count * layout->size;
+	size_t done = 0;
+
+	if (layout->maskCount != 0) {
+		done = shuffleBlocks(input, output, length, layout->masks, layout->maskCount);
+
+		// The blocks always end on a field boundary, finish the rest with the next mask
+		if (done != 0 && done < length) {
+			uint8_t block[16];
+			size_t left = length - done;
+			const uint8_t *mask = &layout->masks[((done / 16) % layout->maskCount) * 16];
+			memcpy(block, &input[done], left);
+			for (size_t i = 0; i < left; ++i) {
+				output[done + i] = block[mask[i]];
+			}
+			return;
+		}
+		if (done == length) return;
+	}
+
+	// Portable kernel, field by field
+	for (size_t record = 0; record < count; ++record) {
+		const uint8_t *in = &input[record * layout->size];
+		uint8_t *out = &output[record * layout->size];
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < layout->fieldCount; ++i) {
+			switch (layout->fieldWidths[i]) {
+			case 4:
+				storeInt(&out[offset], swapInt(loadInt(&in[offset])));
+				break;
+			case 2:
+				storeShort(&out[offset], swapShort(loadShort(&in[offset])));
+				break;
+			default:
+				out[offset] = in[offset];
+				break;
+			}
+			offset += layout->fieldWidths[i];
+		}
+	}
+}
+
+bool buildSchemaLayout(RecordLayout *layout, const RecordSchema *schema) {
+	if (schema->size > RECORD_MAX_SIZE) return false;
+
+	uint8_t fieldWidths[RECORD_MAX_SIZE];
+	uint32_t fieldCount = 0;
+	for (uint32_t i = 0; i < schema->fieldCount; ++i) {
+		const FieldSchema *field = &schema->fields[i];
+		for (uint32_t j = 0; j < field->count; ++j) {
+			if (field->swap) {
+				fieldWidths[fieldCount++] = field->width;
+			}
+			else {
+				// Markers are kept byte by byte
+				for (uint32_t k = 0; k < field->width; ++k) {
+					fieldWidths[fieldCount++] = 1;
+				}
+			}
+		}
+	}
+	return buildRecordLayout(layout, fieldWidths, fieldCount);
+}
+
+void swapRecordFields(const RecordSchema *schema, const uint8_t *input, uint8_t *output, uint32_t length) {
+	for (uint32_t i = 0; i < schema->fieldCount; ++i) {
+		const FieldSchema *field = &schema->fields[i];
+		if (field->offset >= length) break;
+
+		uint32_t count = (length - field->offset) / field->width;
+		if (count > field->count) count = field->count;
+
+		if (!field->swap) {
+			memcpy(&output[field->offset], &input[field->offset], count * field->width);
+		}
+		else if (field->width == 4) {
+			swapInts(&input[field->offset], &output[field->offset], count);
+		}
+		else {
+			swapShorts(&input[field->offset], &output[field->offset], count);
+		}
+	}
+}
+
+// Shuffle layout of a schema, built the first time it's needed (size 0 if the record is too big to shuffle)
+static const RecordLayout* cachedSchemaLayout(const RecordSchema *schema) {
+	static std::mutex lock;
+	static std::map<const RecordSchema*, RecordLayout> layouts;
+
+	std::lock_guard<std::mutex> guard(lock);
+	std::map<const RecordSchema*, RecordLayout>::iterator i = layouts.find(schema);
+	if (i == layouts.end()) {
+		i = layouts.insert(std::make_pair(schema, RecordLayout())).first;
+		if (!buildSchemaLayout(&i->second, schema)) {
+			i->second.size = 0;
+		}
+	}
+	return &i->second;
+}
+
+void swapSchemaRecords(const RecordSchema *schema, const uint8_t *input, uint8_t *output, uint32_t length) {
+	uint32_t whole = length / schema->size;
+	const FieldSchema *field = &schema->fields[0];
+
+	if (schema->size == COLLISION_TRIANGLE_SIZE && isCollisionTriangleLayout(*schema, 0)) {
+		swapCollisionTriangles(input, output, whole);
+	}
+	else if (schema->fieldCount == 1 && field->swap && field->width == 4 && schema->size == 4) {
+		swapInts(input, output, whole);
+	}
+	else if (schema->fieldCount == 1 && field->swap && field->width == 2 && schema->size == 2) {
+		swapShorts(input, output, whole);
+	}
+	else if (schema->fieldCount == 1 && (!field->swap || field->width == 1)) {
+		memmove(output, input, whole * schema->size);
+	}
+	else {
+		const RecordLayout *layout = cachedSchemaLayout(schema);
+		if (layout->size != 0) {
+			swapRecords(layout, input, output, whole);
+		}
+		else {
+			for (uint32_t i = 0; i < whole; ++i) {
+				swapRecordFields(schema, &input[i * schema->size], &output[i * schema->size], schema->size);
+			}
+		}
+	}
+
+	uint32_t start = whole * schema->size;
+	if (start < length) {
+		swapRecordFields(schema, &input[start], &output[start], length - start);
+	}
+}
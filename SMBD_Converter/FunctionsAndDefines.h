@@ -5,7 +5,13 @@
 #endif
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <vector>
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
 
 #define FUNCTIONS_AND_DEFINES
 #define SMB2 0
@@ -64,4 +70,280 @@ inline void writeLittleShort(FILE *file, uint16_t value) {
 	putc((value >> 8), file);
 }
 
+// Streams over memory that behave like the FILE functions above
+// Reads past the end give EOF (still moving forward), writes past the end grow the buffer (zero filling any gap like fseek)
+
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	size_t position;
+}InputStream;
+
+typedef struct {
+	std::vector<uint8_t> *data;
+	size_t position;
+}OutputStream;
+
+inline int readByte(InputStream *stream) {
+	size_t position = stream->position++;
+	return position < stream->size ? stream->data[position] : EOF;
+}
+
+inline void writeByte(OutputStream *stream, int value) {
+	if (stream->position >= stream->data->size()) {
+		stream->data->resize(stream->position + 1);
+	}
+	(*stream->data)[stream->position++] = (uint8_t)value;
+}
+
+inline uint32_t readBigInt(InputStream *stream) {
+	uint32_t c1 = (uint32_t)readByte(stream) << 24;
+	uint32_t c2 = (uint32_t)readByte(stream) << 16;
+	uint32_t c3 = (uint32_t)readByte(stream) << 8;
+	uint32_t c4 = (uint32_t)readByte(stream);
+	return (c1 | c2 | c3 | c4);
+}
+
+inline uint32_t readLittleInt(InputStream *stream) {
+	uint32_t c1 = (uint32_t)readByte(stream);
+	uint32_t c2 = (uint32_t)readByte(stream) << 8;
+	uint32_t c3 = (uint32_t)readByte(stream) << 16;
+	uint32_t c4 = (uint32_t)readByte(stream) << 24;
+	return (c1 | c2 | c3 | c4);
+}
+
+inline uint16_t readBigShort(InputStream *stream) {
+	uint16_t c1 = (uint16_t)readByte(stream) << 8;
+	uint16_t c2 = (uint16_t)readByte(stream);
+	return (c1 | c2);
+}
+
+inline uint16_t readLittleShort(InputStream *stream) {
+	uint16_t c1 = (uint16_t)readByte(stream);
+	uint16_t c2 = (uint16_t)readByte(stream) << 8;
+	return (c1 | c2);
+}
+
+inline void writeBigInt(OutputStream *stream, uint32_t value) {
+	writeByte(stream, value >> 24);
+	writeByte(stream, value >> 16);
+	writeByte(stream, value >> 8);
+	writeByte(stream, value);
+}
+
+inline void writeLittleInt(OutputStream *stream, uint32_t value) {
+	writeByte(stream, value);
+	writeByte(stream, value >> 8);
+	writeByte(stream, value >> 16);
+	writeByte(stream, value >> 24);
+}
+
+inline void writeBigShort(OutputStream *stream, uint16_t value) {
+	writeByte(stream, value >> 8);
+	writeByte(stream, value);
+}
+
+inline void writeLittleShort(OutputStream *stream, uint16_t value) {
+	writeByte(stream, value);
+	writeByte(stream, value >> 8);
+}
+
+// Read values straight from memory
+
+inline uint32_t readBigInt(const uint8_t *data) {
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+inline uint32_t readLittleInt(const uint8_t *data) {
+	return data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+inline uint16_t readBigShort(const uint8_t *data) {
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+inline uint16_t readLittleShort(const uint8_t *data) {
+	return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+// Byte swaps (compile down to a single bswap instruction)
+
+inline uint32_t swapInt(uint32_t value) {
+#ifdef _MSC_VER
+	return _byteswap_ulong(value);
+#else
+	return __builtin_bswap32(value);
+#endif
+}
+
+inline uint16_t swapShort(uint16_t value) {
+#ifdef _MSC_VER
+	return _byteswap_ushort(value);
+#else
+	return __builtin_bswap16(value);
+#endif
+}
+
+inline bool hostIsLittleEndian() {
+	const uint16_t one = 1;
+	return *(const uint8_t *)&one == 1;
+}
+
+// Loads/stores in host order (memcpy so unaligned offsets are fine)
+
+inline uint32_t loadInt(const uint8_t *data) {
+	uint32_t value;
+	memcpy(&value, data, 4);
+	return value;
+}
+
+inline uint16_t loadShort(const uint8_t *data) {
+	uint16_t value;
+	memcpy(&value, data, 2);
+	return value;
+}
+
+inline void storeInt(uint8_t *data, uint32_t value) {
+	memcpy(data, &value, 4);
+}
+
+inline void storeShort(uint8_t *data, uint16_t value) {
+	memcpy(data, &value, 2);
+}
+
+// Byte order of each game's files
+// Converters are templated on these so every direction is its own compiled path (no function pointers per field)
+
+struct SMB2Format {
+	static const int game = SMB2;
+
+	static inline uint32_t readInt(const uint8_t *data) { return hostIsLittleEndian() ? swapInt(loadInt(data)) : loadInt(data); }
+	static inline uint16_t readShort(const uint8_t *data) { return hostIsLittleEndian() ? swapShort(loadShort(data)) : loadShort(data); }
+
+	static inline uint32_t readInt(InputStream *stream) { return readBigInt(stream); }
+	static inline uint16_t readShort(InputStream *stream) { return readBigShort(stream); }
+	static inline void writeInt(OutputStream *stream, uint32_t value) { writeBigInt(stream, value); }
+	static inline void writeShort(OutputStream *stream, uint16_t value) { writeBigShort(stream, value); }
+};
+
+struct SMBDFormat {
+	static const int game = SMBD;
+
+	static inline uint32_t readInt(const uint8_t *data) { return hostIsLittleEndian() ? loadInt(data) : swapInt(loadInt(data)); }
+	static inline uint16_t readShort(const uint8_t *data) { return hostIsLittleEndian() ? loadShort(data) : swapShort(loadShort(data)); }
+
+	static inline uint32_t readInt(InputStream *stream) { return readLittleInt(stream); }
+	static inline uint16_t readShort(InputStream *stream) { return readLittleShort(stream); }
+	static inline void writeInt(OutputStream *stream, uint32_t value) { writeLittleInt(stream, value); }
+	static inline void writeShort(OutputStream *stream, uint16_t value) { writeLittleShort(stream, value); }
+};
+
+// Bulk byte swaps over arrays in memory
+// SSSE3/AVX2 shuffles are used when the cpu supports them, otherwise a portable loop
+// input and output may be the same buffer (in place)
+
+#define SWAP_KERNEL_PORTABLE 0
+#define SWAP_KERNEL_SSSE3 1
+#define SWAP_KERNEL_AVX2 2
+
+// Best kernel this cpu supports (checked once)
+int detectSwapKernel();
+
+// Kernel the bulk swaps use (defaults to detectSwapKernel, can only be lowered)
+int getSwapKernel();
+void setSwapKernel(int kernel);
+
+void swapInts(const uint8_t *input, uint8_t *output, size_t count);
+void swapShorts(const uint8_t *input, uint8_t *output, size_t count);
+
+// Scans up to count shorts for the 0xFFFF that ends a list (ie: collision grid triangle indices)
+// Returns how many shorts come before it (count if there isn't one) and the largest of those in maxValue (0 if none)
+// Values are read big endian if bigEndian is set, little endian otherwise
+size_t scanShortList(const uint8_t *data, size_t count, bool bigEndian, uint16_t *maxValue);
+
+// Fixed layout record (ie: 12 ints then 4 shorts) described by the width of each field in order
+// 4 = int, 2 = short (both swapped), 1 = byte kept as is
+#define RECORD_MAX_SIZE 0x100
+
+typedef struct {
+	uint32_t size;
+	uint32_t fieldCount;
+	uint8_t fieldWidths[RECORD_MAX_SIZE];
+
+	// Shuffle masks for each 16 byte block of lcm(size, 16) bytes of records (plus the first one repeated for 32 byte loads)
+	// maskCount is 0 if a field isn't aligned to its width, then records are always swapped field by field
+	uint32_t maskCount;
+	uint8_t masks[(RECORD_MAX_SIZE / 2 + 1) * 16];
+}RecordLayout;
+
+// Returns false if a width isn't 1, 2 or 4 or the record is bigger than RECORD_MAX_SIZE
+bool buildRecordLayout(RecordLayout *layout, const uint8_t *fieldWidths, uint32_t fieldCount);
+
+// Swaps count back to back records
+void swapRecords(const RecordLayout *layout, const uint8_t *input, uint8_t *output, size_t count);
+
+// Record schemas
+// Every field of a record with its offset, so the whole record is described in one place
+// count fields of the same kind can share an entry (ie: a run of unknown/null ints)
+
+typedef struct {
+	uint16_t offset;
+	uint16_t count;
+	uint8_t width;	// 4 = int, 2 = short
+	uint8_t swap;	// 0 for markers, which keep their byte order
+}FieldSchema;
+
+typedef struct {
+	const char *name;
+	uint32_t size;
+	uint32_t fieldCount;
+	const FieldSchema *fields;
+}RecordSchema;
+
+#define INT_FIELD(offset) { offset, 1, 4, 1 }
+#define INT_FIELDS(offset, count) { offset, count, 4, 1 }
+#define SHORT_FIELD(offset) { offset, 1, 2, 1 }
+#define SHORT_FIELDS(offset, count) { offset, count, 2, 1 }
+#define MARKER_INT(offset) { offset, 1, 4, 0 }
+#define MARKER_INTS(offset, count) { offset, count, 4, 0 }
+#define MARKER_SHORT(offset) { offset, 1, 2, 0 }
+#define MARKER_BYTE(offset) { offset, 1, 1, 0 }
+// Count and offset of a list
+#define ITEM_FIELD(offset) INT_FIELDS(offset, 2)
+
+// Offset just past the last field, or 0xFFFFFFFF if there is a gap or overlap between fields
+constexpr uint32_t schemaFieldsEnd(const FieldSchema *fields, uint32_t count, uint32_t offset) {
+	return count == 0 ? offset :
+		(fields->offset != offset ? 0xFFFFFFFF : schemaFieldsEnd(fields + 1, count - 1, offset + fields->count * fields->width));
+}
+
+// Defines nameSchema from the nameFields array, checking the fields cover exactly length bytes
+#define RECORD_SCHEMA(name, label, length) \
+	static_assert(schemaFieldsEnd(name##Fields, sizeof(name##Fields) / sizeof(FieldSchema), 0) == (length), label " fields don't add up to " #length); \
+	constexpr RecordSchema name##Schema = { label, length, sizeof(name##Fields) / sizeof(FieldSchema), name##Fields }
+
+// Builds the shuffle layout for a schema
+// Returns false if the record is bigger than RECORD_MAX_SIZE
+bool buildSchemaLayout(RecordLayout *layout, const RecordSchema *schema);
+
+// Swaps one record field by field, only fields within the first length bytes are written
+void swapRecordFields(const RecordSchema *schema, const uint8_t *input, uint8_t *output, uint32_t length);
+
+// Swapped width (4/2, 0 for markers or gaps) of the field covering offset
+constexpr uint32_t schemaWidthAt(const FieldSchema *fields, uint32_t count, uint32_t offset) {
+	return count == 0 ? 0 :
+		((offset >= fields->offset && offset < (uint32_t)(fields->offset + fields->count * fields->width)) ? (fields->swap ? fields->width : 0) : schemaWidthAt(fields + 1, count - 1, offset));
+}
+
+// Collision triangles are most of a stage so they get their own kernel with the masks fixed
+// 0x40 bytes: 6 ints, 4 shorts (0x18 - 0x1F), 8 ints
+#define COLLISION_TRIANGLE_SIZE 0x40
+
+void swapCollisionTriangles(const uint8_t *input, uint8_t *output, size_t count);
+
+// Swaps the first length bytes of back to back records of schema with the fastest kernel for it
+// A field cut off by length isn't written (like swapRecordFields)
+// Every swap kernel loads a block before storing it, so input and output can be the same buffer
+void swapSchemaRecords(const RecordSchema *schema, const uint8_t *input, uint8_t *output, uint32_t length);
+
 #endif // !FUNCTIONS_AND_DEFINES
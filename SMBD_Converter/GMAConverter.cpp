@@ -3,6 +3,7 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#include <stdlib.h>
 #include <string>
 #include "FunctionsAndDefines.h"
 
@@ -12,17 +13,17 @@ typedef struct {
 
 }Model;
 
-inline void copyAscii(FILE *input, FILE *output, uint32_t offset) {
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
+inline void copyAscii(InputStream *input, OutputStream *output, uint32_t offset) {
+	input->position = offset;
+	output->position = offset;
 	int c;
 	do {
-		c = getc(input);
+		c = readByte(input);
 		if (c == EOF) {
 			break;
 		}
-		putc(c, output);
-	} while (!feof(input) && c != 0);
+		writeByte(output, c);
+	} while (c != 0);
 }
 
 inline int compareModels(const void* a, const void* b) {
@@ -31,300 +32,279 @@ inline int compareModels(const void* a, const void* b) {
 	return aVal - bVal;
 }
 
-inline void copyChunk(FILE* input, FILE* output, uint32_t chunkSize, uint32_t(*readInt)(FILE*), void(*writeInt)(FILE*, uint32_t), uint16_t(*readShort)(FILE*), void(*writeShort)(FILE*, uint16_t));
+template <typename From, typename To>
+static void convertModels(ConversionContext *context, InputStream *original, OutputStream *converted);
 
-void parseGMA(char* filename) {
-	int game = 0;
-
-	// Using function pointers to read/write values keeps things game agnostic (can convert from SMBD to SMB2 or SMB2 to SMBD)
-	uint32_t(*readInt)(FILE*);
-	void(*writeInt)(FILE*, uint32_t);
-	void(*writeNormalInt)(FILE*, uint32_t);
-
-	uint16_t(*readShort)(FILE*);
-	void(*writeShort)(FILE*, uint16_t);
-	void(*writeNormalShort)(FILE*, uint16_t);
-
-	std::string outfilename = std::string(filename);
-
-	FILE *original = fopen(filename, "rb");
-	FILE* converted;
-
-	std::string inputFile(filename);
+template <typename From, typename To>
+static void copyChunk(ConversionContext *context, InputStream *input, OutputStream *output, uint32_t chunkSize);
 
-	std::string outputFile;
-
-	Model models[256];
+void parseGMA(char* filename) {
+	ConversionContext context;
+	initConversionContext(&context, filename);
 
-	if (original == NULL) {
-		printf("Error opening file\n");
-		return;
+	if (loadInputFile(&context) && convertGMA(&context) == 0) {
+		writeOutputFile(&context, convertedFilename(&context), context.output.data(), context.output.size());
 	}
+	printDiagnostics(&context);
+}
 
-	uint32_t fileLength;
-	fseek(original, 0, SEEK_END);
-	fileLength = ftell(original);
-	fseek(original, 0, SEEK_SET);
-
+int convertGMA(ConversionContext *context) {
+	adviseInputSource(&context->input, INPUT_ACCESS_SEQUENTIAL);
+	InputStream original = { context->input.data, context->input.size, 0 };
+	context->output.clear();
+	OutputStream converted = { &context->output, 0 };
 
 	// Check which game it is
-	if (readBigShort(original) != 0)  {
-		game = SMBD;
-		outputFile = inputFile + ".smb2";
-		// Open the output file
-		converted = fopen(outputFile.c_str(), "wb");
-
-		// Set correct IO functions
-		readInt = &readLittleInt;
-		readShort = &readLittleShort;
-
-		writeInt = &writeBigInt;
-		writeShort = &writeBigShort;
+	if (context->sourceGame == GAME_UNKNOWN) {
+		context->sourceGame = readBigShort(&original) != 0 ? SMBD : SMB2;
+		original.position = 0;
+	}
 
-		writeNormalInt = &writeLittleInt;
-		writeNormalShort = &writeLittleShort;
+	if (context->sourceGame == SMBD) {
+		context->targetGame = SMB2;
+		convertModels<SMBDFormat, SMB2Format>(context, &original, &converted);
 	}
 	else {
-		game = SMB2;
-		fseek(original, 0, SEEK_SET);
-		outputFile = inputFile + ".smbd";
-		// Open the output file
-		converted = fopen(outputFile.c_str(), "wb");
-
-		// Set correct IO functions
-		readInt = &readBigInt;
-		readShort = &readBigShort;
-
-		writeInt = &writeLittleInt;
-		writeShort = &writeLittleShort;
-
-		writeNormalInt = &writeBigInt;
-		writeNormalShort = &writeBigShort;
+		context->targetGame = SMBD;
+		convertModels<SMB2Format, SMBDFormat>(context, &original, &converted);
 	}
+	return hasErrors(context) ? -1 : 0;
+}
 
-	fseek(original, 0, SEEK_SET);
-
+template <typename From, typename To>
+static void convertModels(ConversionContext *context, InputStream *original, OutputStream *converted) {
 	// Num models
-	uint32_t numModels = readInt(original);
-	writeInt(converted, numModels);
+	uint32_t numModels = From::readInt(original);
+	To::writeInt(converted, numModels);
+
+	// Each model needs 8 bytes of offsets so anything more can't be in the file
+	if (numModels > original->size / 8) {
+		addDiagnostic(context, DIAGNOSTIC_WARNING, "%s: Number of models (%u) doesn't fit in the file", context->filename.c_str(), numModels);
+		numModels = (uint32_t)(original->size / 8);
+	}
+	std::vector<Model> models(numModels);
 
 	// Model Data Base Offset
-	uint32_t modelBaseOffset = readInt(original);
-	writeInt(converted, modelBaseOffset);
+	uint32_t modelBaseOffset = From::readInt(original);
+	To::writeInt(converted, modelBaseOffset);
 
 	// Copy models offsets
 	for (int i = 0; i < (int)numModels; ++i) {
 		// Model offset from model base
-		models[i].modelOffsetFromBase = readInt(original);
-		writeInt(converted, models[i].modelOffsetFromBase);
+		models[i].modelOffsetFromBase = From::readInt(original);
+		To::writeInt(converted, models[i].modelOffsetFromBase);
 
 		// Name offset from name base
-		models[i].nameOffsetFromNames = readInt(original);
-		writeInt(converted, models[i].nameOffsetFromNames);
+		models[i].nameOffsetFromNames = From::readInt(original);
+		To::writeInt(converted, models[i].nameOffsetFromNames);
 	}
 
 	// Sort models by name offset to ensure we can add trailing zeros
-	qsort(models, numModels, sizeof(Model), &compareModels);
+	qsort(models.data(), numModels, sizeof(Model), &compareModels);
 
 	// Copy models names
-	uint32_t nameOffset = ftell(original);
+	uint32_t nameOffset = (uint32_t)original->position;
 	for (int i = 0; i < (int)numModels; ++i) {
 		copyAscii(original, converted, nameOffset + models[i].nameOffsetFromNames);
 	}
 
 	// Copy padding until we are at the model base
-	while (ftell(original) < (int) modelBaseOffset) {
-		putc(getc(original), converted);
+	while (original->position < modelBaseOffset && original->position < original->size) {
+		writeByte(converted, readByte(original));
 	}
 
 
 	// Copy Models
 	for (int i = 0; i < (int)numModels; ++i) {
-		fseek(original, modelBaseOffset + models[i].modelOffsetFromBase, SEEK_SET);
-		fseek(converted, modelBaseOffset + models[i].modelOffsetFromBase, SEEK_SET);
+		uint32_t modelOffset = modelBaseOffset + models[i].modelOffsetFromBase;
+		if (modelOffset >= original->size) {
+			addDiagnostic(context, DIAGNOSTIC_WARNING, "%s: Model %d is past the end of the file", context->filename.c_str(), i);
+			continue;
+		}
+		original->position = modelOffset;
+		converted->position = modelOffset;
 
 		// ASCII (int) "GCMF"
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Unknown uint32
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// 4 Unknown Floats (0x10)
 		for (int j = 0; j < 0x10 / 4; ++j) {
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 		}
 
 		// Number of textures
-		uint16_t numTextures = readShort(original);
-		writeShort(converted, numTextures);
+		uint16_t numTextures = From::readShort(original);
+		To::writeShort(converted, numTextures);
 
 		// Number of textures in section 1
-		uint16_t numTexturesSection1 = readShort(original);
-		writeShort(converted, numTexturesSection1);
+		uint16_t numTexturesSection1 = From::readShort(original);
+		To::writeShort(converted, numTexturesSection1);
 
 		// Number of textures in section 2
-		uint16_t numTexturesSection2 = readShort(original);
-		writeShort(converted, numTexturesSection2);
+		uint16_t numTexturesSection2 = From::readShort(original);
+		To::writeShort(converted, numTexturesSection2);
 
 		// Number of header blobs (unknown)?
-		putc(getc(original), converted);
+		writeByte(converted, readByte(original));
 
 		// Check byte (0x00)
-		putc(getc(original), converted);
+		writeByte(converted, readByte(original));
 
 		// End of header offset (unknown)?
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check uint32 (0)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check int32 (-1)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check int32 (-1)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check uint32 (0)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check uint32 (0)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check uint32 (0)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check uint32 (0)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 
 		// Copy texture headers
 		for (int j = 0; j < numTextures; ++j) {
 			// Unknown int (lat byte = clamping: 0x80 CLAMP BOTH, 0x84 CLAMP T 0x90 CLAMP S, 0x94 NO CLAMP)
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 
 			// TPL texture number
-			writeShort(converted, readShort(original));
+			To::writeShort(converted, From::readShort(original));
 
 			// Unknown uint16
-			writeShort(converted, readShort(original));
+			To::writeShort(converted, From::readShort(original));
 
 			// Check uint32 (0)
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 
 			// Unknown uint16
-			writeShort(converted, readShort(original));
+			To::writeShort(converted, From::readShort(original));
 
 			// Texture index
-			writeShort(converted, readShort(original));
+			To::writeShort(converted, From::readShort(original));
 
 			// Unknown uint32
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 
 			// Check uint32 (0)
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 
 			// Check uint32 (0)
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 
 			// Check uint32 (0)
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 		}
 
 		// Section Header
 		// 5 Unknown uint32 (0x14)
 		for (int j = 0; j < 0x14 / 4; ++j) {
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 		}
 
 		// 4 Unknown uint16 (0x8)
 		for (int j = 0; j < 0x8 / 2; ++j) {
-			writeShort(converted, readShort(original));
+			To::writeShort(converted, From::readShort(original));
 		}
 
 		// Vertex flags
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check int32 (-1)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Check int32 (-1)
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// Chunk 1 size
-		uint32_t chunk1Size = readInt(original);
-		writeInt(converted, chunk1Size);
+		uint32_t chunk1Size = From::readInt(original);
+		To::writeInt(converted, chunk1Size);
 
 		// Chunk 2 size
-		uint32_t chunk2Size = readInt(original);
-		writeInt(converted, chunk2Size);
+		uint32_t chunk2Size = From::readInt(original);
+		To::writeInt(converted, chunk2Size);
 
 		// 4 Unknown float (0x10)
 		for (int j = 0; j < 0x10 / 4; ++j) {
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 		}
 
 		// Unknown uint32
-		writeInt(converted, readInt(original));
+		To::writeInt(converted, From::readInt(original));
 
 		// 7 Check int32 (0) (0x1C)
 		for (int j = 0; j < 0x1C / 4; ++j) {
-			writeInt(converted, readInt(original));
+			To::writeInt(converted, From::readInt(original));
 		}
 
-		copyChunk(original, converted, chunk1Size, readInt, writeInt, readShort, writeShort);
-		copyChunk(original, converted, chunk2Size, readInt, writeInt, readShort, writeShort);
+		copyChunk<From, To>(context, original, converted, chunk1Size);
+		copyChunk<From, To>(context, original, converted, chunk2Size);
 	}
 
-	fclose(original);
-	fclose(converted);
 }
 
-inline void copyChunk(FILE* input, FILE* output, uint32_t chunkSize, uint32_t(*readInt)(FILE*), void(*writeInt)(FILE*, uint32_t), uint16_t(*readShort)(FILE*), void(*writeShort)(FILE*, uint16_t)) {
+template <typename From, typename To>
+static void copyChunk(ConversionContext *context, InputStream *input, OutputStream *output, uint32_t chunkSize) {
 	if (chunkSize == 0) { return; }
-	uint32_t initialPos = ftell(input);
+	uint32_t initialPos = (uint32_t)input->position;
 	
 	// Filler
-	putc(getc(input), output);
+	writeByte(output, readByte(input));
 	
 	// Make sure there is enough space left for another section (min size: 39 (0x27))
-	while(ftell(input) - initialPos < chunkSize - 39) {
+	while(input->position - initialPos < chunkSize - 39) {
 		// Type
-		uint8_t type = (uint8_t) getc(input);
-		putc(type, output);
+		uint8_t type = (uint8_t)readByte(input);
+		writeByte(output, type);
 
 		// Error checking/there may be a type 99 to support
 		if (type != 0x98) {
-			printf("NOT 98: %d\nAT: %#04x", type, ftell(input));
+			addDiagnostic(context, DIAGNOSTIC_WARNING, "%s: NOT 98: %d AT: %#04x", context->filename.c_str(), type, (uint32_t)input->position);
 			return;
 		}
 
 		// Num verteces in part
-		uint16_t numVerts = readShort(input);
-		writeShort(output, numVerts);
-
-		// Copy verteces in part
-		for (int j = 0; j < numVerts; ++j) {
-			// Position (X, Y, Z)
-			writeInt(output, readInt(input));
-			writeInt(output, readInt(input));
-			writeInt(output, readInt(input));
-
-			// Normal (I, J, K)
-			writeInt(output, readInt(input));
-			writeInt(output, readInt(input));
-			writeInt(output, readInt(input));
-
-			// Color RGBA
-			writeInt(output, readInt(input));
-
-			// Texture (S, T)
-			writeInt(output, readInt(input));
-			writeInt(output, readInt(input));
+		uint16_t numVerts = From::readShort(input);
+		To::writeShort(output, numVerts);
+
+		// Copy verteces in part (length = 0x24 each, all ints)
+		// Position (X, Y, Z)
+		// Normal (I, J, K)
+		// Color RGBA
+		// Texture (S, T)
+		size_t partSize = numVerts * 0x24;
+		size_t available = input->position < input->size ? input->size - input->position : 0;
+		if (output->position + partSize > output->data->size()) {
+			output->data->resize(output->position + partSize);
 		}
+		uint8_t *part = &(*output->data)[output->position];
+		memcpy(part, &input->data[input->position], partSize < available ? partSize : available);
+		// Past the end of the file reads as all 1s like EOF
+		if (partSize > available) {
+			memset(&part[available], 0xFF, partSize - available);
+		}
+		swapInts(part, part, numVerts * 9);
+		input->position += partSize;
+		output->position += partSize;
 	}
 
 	// Trailing zeros
-	while (ftell(input) - initialPos < chunkSize) {
-		putc(getc(input), output);
+	while (input->position - initialPos < chunkSize && input->position < input->size) {
+		writeByte(output, readByte(input));
 	}
-}
\ No newline at end of file
+}
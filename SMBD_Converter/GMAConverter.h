@@ -1,3 +1,10 @@
 #pragma once
 
-void parseGMA(char* filename);
\ No newline at end of file
+#include "ConversionContext.h"
+
+// Converts a gma file to the other game and writes it next to the original (.smb2/.smbd)
+void parseGMA(char* filename);
+
+// Converts the gma in context->input into context->output
+// Returns 0 on success or -1 on error
+int convertGMA(ConversionContext *context);
@@ -0,0 +1,182 @@
+#include "InputSource.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+void initInputSource(InputSource *input) {
+	input->data = NULL;
+	input->size = 0;
+	input->writable = NULL;
+	input->mapping.reset();
+	input->buffer.clear();
+}
+
+#ifdef _WIN32
+
+static bool openInput(InputSource *input, const char *filename, bool writable) {
+	initInputSource(input);
+
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+	size_t size = (size_t)fileSize.QuadPart;
+
+	// Empty files can't be mapped
+	if (size != 0) {
+		HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			uint8_t *view = (uint8_t*)MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+			// The view keeps the file open
+			CloseHandle(mapping);
+			if (view != NULL) {
+				CloseHandle(file);
+				input->mapping.reset(view, [](const uint8_t *data) { UnmapViewOfFile(data); });
+				input->data = view;
+				input->size = size;
+				input->writable = writable ? view : NULL;
+				return true;
+			}
+		}
+	}
+
+	// Fall back to reading it all at once
+	input->buffer.resize(size);
+	size_t total = 0;
+	while (total < size) {
+		DWORD chunk = (size - total) > 0x40000000 ? 0x40000000 : (DWORD)(size - total);
+		DWORD read = 0;
+		if (!ReadFile(file, &input->buffer[total], chunk, &read, NULL) || read == 0) {
+			break;
+		}
+		total += read;
+	}
+	CloseHandle(file);
+	input->buffer.resize(total);
+	input->data = input->buffer.data();
+	input->size = total;
+	input->writable = input->buffer.data();
+	return true;
+}
+
+void adviseInputSource(const InputSource *input, int access) {
+	// No madvise equivalent worth using on Windows
+	(void)input;
+	(void)access;
+}
+
+#else
+
+static bool openInput(InputSource *input, const char *filename, bool writable) {
+	initInputSource(input);
+
+	int file = open(filename, O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0) {
+		close(file);
+		return false;
+	}
+	size_t size = (size_t)info.st_size;
+
+	// Empty files (and pipes/devices) can't be mapped
+	if (size != 0 && S_ISREG(info.st_mode)) {
+		// Private mappings can be written to even though the file is only open for reading
+		void *view = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED) {
+			close(file);
+			input->mapping.reset((const uint8_t*)view, [size](const uint8_t *data) { munmap((void*)data, size); });
+			input->data = (const uint8_t*)view;
+			input->size = size;
+			input->writable = writable ? (uint8_t*)view : NULL;
+			return true;
+		}
+	}
+
+	// Fall back to reading it all at once (pipes don't know their size, so those are read until they end)
+	input->buffer.resize(S_ISREG(info.st_mode) ? size : 0x10000);
+	size_t total = 0;
+	while (true) {
+		if (total == input->buffer.size()) {
+			if (S_ISREG(info.st_mode)) {
+				break;
+			}
+			input->buffer.resize(total * 2);
+		}
+		ssize_t read = ::read(file, &input->buffer[total], input->buffer.size() - total);
+		if (read <= 0) {
+			break;
+		}
+		total += (size_t)read;
+	}
+	close(file);
+	input->buffer.resize(total);
+	input->data = input->buffer.data();
+	input->size = total;
+	input->writable = input->buffer.data();
+	return true;
+}
+
+void adviseInputSource(const InputSource *input, int access) {
+	if (input->mapping == NULL || input->size == 0) {
+		return;
+	}
+	void *start = (void*)input->data;
+	switch (access) {
+	case INPUT_ACCESS_SEQUENTIAL:
+		madvise(start, input->size, MADV_SEQUENTIAL);
+		break;
+	case INPUT_ACCESS_RANDOM:
+		// Most of it is read anyway, so start reading it all now and don't read ahead of each jump
+		madvise(start, input->size, MADV_RANDOM);
+		madvise(start, input->size, MADV_WILLNEED);
+		break;
+	case INPUT_ACCESS_SPARSE:
+		madvise(start, input->size, MADV_RANDOM);
+		break;
+	case INPUT_ACCESS_DONE:
+		// Dropping written pages of a private mapping would throw the changes away
+		if (input->writable == NULL) {
+			madvise(start, input->size, MADV_DONTNEED);
+		}
+		break;
+	}
+}
+
+#endif
+
+bool openInputSource(InputSource *input, const char *filename) {
+	return openInput(input, filename, false);
+}
+
+bool openWritableInputSource(InputSource *input, const char *filename) {
+	return openInput(input, filename, true);
+}
+
+void setInputBuffer(InputSource *input, std::vector<uint8_t> *buffer) {
+	input->mapping.reset();
+	input->buffer.swap(*buffer);
+	input->data = input->buffer.data();
+	input->size = input->buffer.size();
+	input->writable = input->buffer.data();
+}
+
+void closeInputSource(InputSource *input) {
+	initInputSource(input);
+}
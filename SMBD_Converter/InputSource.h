@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+// How a converter is about to read its input (used as a hint for the OS when the file is mapped)
+// Sequential: read front to back once (lz decoding, gma/tpl walks)
+#define INPUT_ACCESS_SEQUENTIAL 0
+// Random: jumps around by pointers but needs most of the file (raw lz stages)
+#define INPUT_ACCESS_RANDOM 1
+// Sparse: jumps around but only reads a little (walking the pointers of a stage before reading it front to back)
+#define INPUT_ACCESS_SPARSE 2
+// Done: the pages won't be needed again
+#define INPUT_ACCESS_DONE 3
+
+// A whole input file in memory
+// The file is mapped when it can be, otherwise it's read into buffer with a single read
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	// data when it can be changed (the buffer or a copy on write mapping), NULL if it's read only
+	// Changes only stay in memory, the file is never written
+	uint8_t *writable;
+
+	// Keeps the mapping alive (unmapped when the last copy goes away), NULL if data isn't mapped
+	std::shared_ptr<const uint8_t> mapping;
+	// The file (or data made in memory, ie: a decompressed lz) when it isn't mapped
+	std::vector<uint8_t> buffer;
+}InputSource;
+
+void initInputSource(InputSource *input);
+
+// Maps filename (or reads it if mapping fails)
+// Returns false if the file can't be opened
+bool openInputSource(InputSource *input, const char *filename);
+
+// Same as openInputSource but the data can be changed through input->writable (ie: to convert it in place)
+// Mapped pages are only copied once they are written to
+bool openWritableInputSource(InputSource *input, const char *filename);
+
+// Replaces the input with buffer (swapped in, buffer gets the old buffer, which is empty if the input was mapped)
+void setInputBuffer(InputSource *input, std::vector<uint8_t> *buffer);
+
+void closeInputSource(InputSource *input);
+
+// Tells the OS how the input is about to be read (nothing if it isn't mapped)
+void adviseInputSource(const InputSource *input, int access);
@@ -0,0 +1,585 @@
+#include "LZCompression.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// The fast loop decodes a whole control block at a time without bounds checks
+// so it needs room for 8 references in the input and 8 maximum length references (plus wide copy overrun) in the output
+#define FAST_INPUT_MARGIN (1 + 8 * 2)
+#define FAST_OUTPUT_MARGIN (8 * LZ_MAX_MATCH + 8)
+
+static inline void copy8(uint8_t* dst, const uint8_t* src) {
+	memcpy(dst, src, 8);
+}
+
+// Decodes control blocks while there is plenty of input and output left
+// phase is the position in the file of output[0] (only the low 12 bits matter, references are relative to the window)
+// Returns the new output position, in is advanced past what was consumed
+static size_t decompressLZFast(const uint8_t** inPtr, const uint8_t* inEnd, uint8_t* output, size_t memPosition, size_t outputSize, uint32_t phase) {
+	const uint8_t* in = *inPtr;
+
+	while (inEnd - in >= FAST_INPUT_MARGIN && outputSize - memPosition >= FAST_OUTPUT_MARGIN) {
+		uint8_t block = *in;
+
+		// All literals, copy them all at once
+		if (block == 0xFF) {
+			copy8(&output[memPosition], in + 1);
+			in += 9;
+			memPosition += 8;
+			continue;
+		}
+
+		++in;
+		for (int j = 0; j < 8; ++j) {
+			if (block & 0x01) {
+				output[memPosition++] = *in++;
+			}
+			else {
+				int length = (in[1] & 0x0F) + LZ_MIN_MATCH;
+				int offset = in[0] | ((in[1] & 0xF0) << 4);
+				in += 2;
+
+				int backSet = ((int)(memPosition + phase) - LZ_MAX_MATCH - offset) & 0xFFF;
+				if (backSet == 0) {
+					backSet = LZ_WINDOW_SIZE;
+				}
+
+				uint8_t* dst = &output[memPosition];
+				if ((size_t)backSet > memPosition) {
+					// Starts before the beginning of the file, which reads as zeros (only possible in the first 4KB)
+					int amt = backSet - (int)memPosition;
+					if (length <= amt) {
+						amt = length;
+					}
+					memset(dst, 0, amt);
+					for (int k = amt; k < length; ++k) {
+						dst[k] = output[memPosition + k - backSet];
+					}
+				}
+				else if (backSet >= 8) {
+					const uint8_t* src = dst - backSet;
+					// Each 8 bytes chunk is fully written before it is read again so overlap is fine
+					// (the overrun past length is inside the output margin and gets overwritten later)
+					copy8(dst, src);
+					copy8(dst + 8, src + 8);
+					if (length > 16) {
+						copy8(dst + 16, src + 16);
+					}
+				}
+				else if (backSet == 1) {
+					// Run of a single byte
+					memset(dst, dst[-1], length);
+				}
+				else {
+					// Short repeating pattern, copy it forward a byte at a time
+					const uint8_t* src = dst - backSet;
+					for (int k = 0; k < length; ++k) {
+						dst[k] = src[k];
+					}
+				}
+				memPosition += length;
+			}
+			block = block >> 1;
+		}
+	}
+
+	*inPtr = in;
+	return memPosition;
+}
+
+int readLZHeader(const uint8_t* input, size_t inputSize, uint32_t* compressedSize, uint32_t* dataSize) {
+	if (inputSize < LZ_HEADER_SIZE) {
+		return LZ_ERROR_HEADER;
+	}
+
+	// Compressed size includes the 8 byte header (FF7 LZS only counts the data)
+	uint32_t csize = input[0] | (input[1] << 8) | (input[2] << 16) | ((uint32_t)input[3] << 24);
+	if (csize < LZ_HEADER_SIZE) {
+		return LZ_ERROR_HEADER;
+	}
+
+	// Anything bigger can't be in the file (no need to trust it for allocating output)
+	uint32_t size = input[4] | (input[5] << 8) | (input[6] << 16) | ((uint32_t)input[7] << 24);
+	if (size > maxDecompressedLZSize(csize)) {
+		return LZ_ERROR_HEADER;
+	}
+
+	*compressedSize = csize;
+	*dataSize = size;
+	return 0;
+}
+
+uint64_t maxDecompressedLZSize(uint32_t compressedSize) {
+	// A control block and 8 references (17 bytes) are at most 8 * 18 bytes, a partial block at the end less than that
+	if (compressedSize <= LZ_HEADER_SIZE) {
+		return 0;
+	}
+	return (uint64_t)(compressedSize - LZ_HEADER_SIZE) / (1 + 8 * 2) * (8 * LZ_MAX_MATCH) + 8 * LZ_MAX_MATCH;
+}
+
+// Decodes into output until the data or output runs out
+// With prefix, filling output isn't an error, decoding just stops there (a reference is cut off where output ends)
+static int decodeLZ(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize, bool prefix) {
+	uint32_t csize;
+	uint32_t dataSize;
+	if (readLZHeader(input, inputSize, &csize, &dataSize) != 0) {
+		return LZ_ERROR_HEADER;
+	}
+
+	// Only decode the data the header says is there (and that we actually have)
+	const uint8_t* in = input + LZ_HEADER_SIZE;
+	const uint8_t* inEnd = input + (csize < inputSize ? csize : inputSize);
+	size_t memPosition = 0;
+
+	// Loop until we reach the end of the data (or have all of the prefix)
+	while (in < inEnd && !(prefix && memPosition >= outputSize)) {
+		// Take the fast path whenever we are far enough from the buffer ends
+		memPosition = decompressLZFast(&in, inEnd, output, memPosition, outputSize, 0);
+		if (in >= inEnd) {
+			break;
+		}
+
+		// Read the first control block
+		// Read right to left, each bit specifies how the the next 8 spots of data will be
+		// 0 means write the byte directly to the output
+		// 1 represents there will be reference (2 byte)
+		uint8_t block = *in++;
+
+		// Go through every bit in the control block
+		for (int j = 0; j < 8 && in < inEnd; ++j) {
+			// Literal byte copy
+			if (block & 0x01) {
+				if (memPosition >= outputSize) {
+					return prefix ? (int)memPosition : LZ_ERROR_OUTPUT_FULL;
+				}
+				output[memPosition++] = *in++;
+			}// Reference
+			else {
+				if (inEnd - in < 2) {
+					return LZ_ERROR_TRUNCATED;
+				}
+				uint16_t reference = (uint16_t)((in[0] << 8) | in[1]);
+				in += 2;
+
+				// Length is the last four bits + 3
+				// Any less than a lengh of 3 i pointess since a reference takes up 3 bytes
+				// Length is the last nibble (last 4 bits) of the 2 reference bytes
+				int length = (reference & 0x000F) + LZ_MIN_MATCH;
+
+				// Offset if is all 8 bits in the first reference byte and the first nibble (4 bits) in the second reference byte
+				// The nibble from the second reference byte comes before the first reference byte
+				// EX: reference bytes = 0x12 0x34
+				//     offset = 0x312
+				int offset = ((reference & 0xFF00) >> 8) | ((reference & 0x00F0) << 4);
+
+				// Convert the offset to how many bytes away from the end of the buffer to start reading from
+				// (0 means a full window back)
+				int backSet = ((int)memPosition - LZ_MAX_MATCH - offset) & 0xFFF;
+				if (backSet == 0) {
+					backSet = LZ_WINDOW_SIZE;
+				}
+
+				if (outputSize - memPosition < (size_t)length) {
+					if (!prefix) {
+						return LZ_ERROR_OUTPUT_FULL;
+					}
+					length = (int)(outputSize - memPosition);
+				}
+
+				// Calculate the actual location in the file
+				ptrdiff_t readLocation = (ptrdiff_t)memPosition - backSet;
+
+				// Handle case where the offset is past the beginning of the file
+				if (readLocation < 0) {
+					// Determine how many zeros to write
+					int amt = (int)-readLocation;
+					if (length <= amt) {
+						amt = length;
+					}
+					// Write the zeros
+					memset(&output[memPosition], 0, amt);
+					// Ajuest positions and number of bytes left to copy
+					length -= amt;
+					readLocation += amt;
+					memPosition += amt;
+				}
+
+				// Copy the rest of the reference bytes
+				while (length-- > 0) {
+					output[memPosition++] = output[readLocation++];
+				}
+			}
+			// Go to the next reference bit in the block
+			block = block >> 1;
+		}
+	}
+
+	return (int)memPosition;
+}
+
+int decompressLZ(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize) {
+	return decodeLZ(input, inputSize, output, outputSize, false);
+}
+
+int decompressLZPrefix(const uint8_t* input, size_t inputSize, uint8_t* output, size_t length) {
+	return decodeLZ(input, inputSize, output, length, true);
+}
+
+void beginLZDecode(LZDecoderState* state) {
+	state->inputPosition = LZ_HEADER_SIZE;
+	state->outputPosition = 0;
+	state->block = 0;
+	state->blockBits = 0;
+}
+
+int continueLZDecode(const uint8_t* input, size_t inputSize, LZDecoderState* state, uint8_t* output, uint32_t outputBase, size_t outputSize, uint32_t stop) {
+	uint32_t csize;
+	uint32_t dataSize;
+	if (readLZHeader(input, inputSize, &csize, &dataSize) != 0) {
+		return LZ_ERROR_HEADER;
+	}
+	if (state->inputPosition < LZ_HEADER_SIZE || state->outputPosition < outputBase) {
+		return LZ_ERROR_HEADER;
+	}
+
+	const uint8_t* inEnd = input + (csize < inputSize ? csize : inputSize);
+	const uint8_t* in = input + state->inputPosition;
+	size_t memPosition = state->outputPosition - outputBase;
+	size_t startPosition = memPosition;
+	size_t stopPosition = stop > outputBase ? stop - outputBase : 0;
+	uint8_t block = state->block;
+	int blockBits = state->blockBits;
+	uint32_t phase = outputBase & 0xFFF;
+	int result = 0;
+
+	while (memPosition < stopPosition && in < inEnd) {
+		if (blockBits == 0) {
+			// Whole blocks at a time until close to stop
+			size_t fastEnd = stopPosition + FAST_OUTPUT_MARGIN < outputSize ? stopPosition + FAST_OUTPUT_MARGIN : outputSize;
+			if (memPosition + FAST_OUTPUT_MARGIN <= fastEnd) {
+				memPosition = decompressLZFast(&in, inEnd, output, memPosition, fastEnd, phase);
+				if (memPosition >= stopPosition || in >= inEnd) {
+					break;
+				}
+			}
+			block = *in++;
+			blockBits = 8;
+			continue;
+		}
+
+		if (block & 0x01) {
+			if (memPosition >= outputSize) {
+				result = LZ_ERROR_OUTPUT_FULL;
+				break;
+			}
+			output[memPosition++] = *in++;
+		}
+		else {
+			if (inEnd - in < 2) {
+				result = LZ_ERROR_TRUNCATED;
+				break;
+			}
+			int length = (in[1] & 0x0F) + LZ_MIN_MATCH;
+			int offset = in[0] | ((in[1] & 0xF0) << 4);
+			if (outputSize - memPosition < (size_t)length) {
+				result = LZ_ERROR_OUTPUT_FULL;
+				break;
+			}
+			in += 2;
+
+			int backSet = ((int)(memPosition + phase) - LZ_MAX_MATCH - offset) & 0xFFF;
+			if (backSet == 0) {
+				backSet = LZ_WINDOW_SIZE;
+			}
+
+			// Only reaches before output[0] when it's before the start of the file
+			ptrdiff_t readLocation = (ptrdiff_t)memPosition - backSet;
+			if (readLocation < 0) {
+				int amt = (int)-readLocation;
+				if (length <= amt) {
+					amt = length;
+				}
+				memset(&output[memPosition], 0, amt);
+				length -= amt;
+				readLocation += amt;
+				memPosition += amt;
+			}
+			while (length-- > 0) {
+				output[memPosition++] = output[readLocation++];
+			}
+		}
+		block = block >> 1;
+		--blockBits;
+	}
+
+	state->inputPosition = (uint32_t)(in - input);
+	state->outputPosition = (uint32_t)(outputBase + memPosition);
+	state->block = block;
+	state->blockBits = (uint8_t)blockBits;
+	return result != 0 ? result : (int)(memPosition - startPosition);
+}
+
+int streamLZ(const uint8_t* input, size_t inputSize, size_t chunkSize, const LZSink& sink) {
+	uint32_t csize;
+	uint32_t dataSize;
+	if (readLZHeader(input, inputSize, &csize, &dataSize) != 0) {
+		return LZ_ERROR_HEADER;
+	}
+	if (chunkSize == 0 || chunkSize > 0x7FFFFFFF) {
+		chunkSize = LZ_STREAM_CHUNK_SIZE;
+	}
+	uint32_t inputEnd = (uint32_t)(csize < inputSize ? csize : inputSize);
+
+	// The window followed by the chunk being decoded (buffer[0] is position base)
+	// Once a chunk is handed over its last 4KB slide down to be the next chunk's window
+	std::vector<uint8_t> buffer(LZ_WINDOW_SIZE + chunkSize + LZ_MAX_MATCH);
+	uint32_t base = 0;
+	uint32_t written = 0;
+	LZDecoderState state;
+	beginLZDecode(&state);
+
+	while (written < dataSize) {
+		uint32_t stop = dataSize - written < chunkSize ? dataSize : written + (uint32_t)chunkSize;
+		int decoded = continueLZDecode(input, inputSize, &state, buffer.data(), base, buffer.size(), stop);
+		if (decoded < 0) {
+			return decoded;
+		}
+
+		uint32_t end = state.outputPosition < stop ? state.outputPosition : stop;
+		if (end > written && !sink(&buffer[written - base], end - written)) {
+			return LZ_ERROR_STOPPED;
+		}
+		written = end;
+		if (state.outputPosition < stop) {
+			// The data ended early
+			return (int)written;
+		}
+
+		uint32_t windowStart = stop > LZ_WINDOW_SIZE ? stop - LZ_WINDOW_SIZE : 0;
+		memmove(buffer.data(), &buffer[windowStart - base], state.outputPosition - windowStart);
+		base = windowStart;
+	}
+
+	// Anything still in the stream would be past the end of the data
+	if (state.outputPosition > dataSize || (state.inputPosition < inputEnd && !(state.blockBits == 0 && inputEnd - state.inputPosition == 1))) {
+		return LZ_ERROR_OUTPUT_FULL;
+	}
+	return (int)written;
+}
+
+// Match finder hash table (hash of the next 3 bytes -> most recent position)
+#define HASH_BITS 14
+#define HASH_SIZE (1 << HASH_BITS)
+#define NO_POSITION -1
+
+// References can reach 4095 bytes back (the full window would be 0 which isn't supported by every decoder)
+#define MAX_DISTANCE (LZ_WINDOW_SIZE - 1)
+
+typedef struct {
+	int maxChain;
+	int niceLength;
+	bool lazy;
+}CompressionLevel;
+
+static const CompressionLevel compressionLevels[LZ_LEVEL_BEST + 1] = {
+	{ 0, 0, false },
+	{ 4, 8, false },
+	{ 8, 12, false },
+	{ 16, LZ_MAX_MATCH, false },
+	{ 32, LZ_MAX_MATCH, false },
+	{ 64, LZ_MAX_MATCH, true },
+	{ 128, LZ_MAX_MATCH, true },
+	{ 256, LZ_MAX_MATCH, true },
+	{ 1024, LZ_MAX_MATCH, true },
+	{ LZ_WINDOW_SIZE, LZ_MAX_MATCH, true },
+};
+
+typedef struct {
+	const uint8_t* input;
+	int inputSize;
+	int32_t* head;
+	int32_t* prev;
+	CompressionLevel level;
+}MatchFinder;
+
+static inline uint32_t hashBytes(const uint8_t* data) {
+	uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16);
+	return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static inline void insertPosition(MatchFinder* finder, int position) {
+	if (position + LZ_MIN_MATCH > finder->inputSize) {
+		return;
+	}
+	uint32_t hash = hashBytes(&finder->input[position]);
+	finder->prev[position & (LZ_WINDOW_SIZE - 1)] = finder->head[hash];
+	finder->head[hash] = position;
+}
+
+// Finds the longest match for position in the window (position must not be inserted yet)
+// Returns the match length (0 if there is no usable match)
+static int findMatch(MatchFinder* finder, int position, int* distance) {
+	const uint8_t* input = finder->input;
+	int maxLength = finder->inputSize - position;
+	if (maxLength > LZ_MAX_MATCH) {
+		maxLength = LZ_MAX_MATCH;
+	}
+	if (maxLength < LZ_MIN_MATCH) {
+		return 0;
+	}
+
+	int bestLength = 0;
+	int candidate = finder->head[hashBytes(&input[position])];
+	int chain = finder->level.maxChain;
+	while (candidate != NO_POSITION && position - candidate <= MAX_DISTANCE && chain-- > 0) {
+		// Check the byte after the current best first since it is the one most likely to differ
+		if (input[candidate + bestLength] == input[position + bestLength] || bestLength == 0) {
+			int length = 0;
+			while (length < maxLength && input[candidate + length] == input[position + length]) {
+				++length;
+			}
+			if (length > bestLength) {
+				bestLength = length;
+				*distance = position - candidate;
+				if (length >= finder->level.niceLength || length == maxLength) {
+					break;
+				}
+			}
+		}
+
+		// The chain is a ring so stop if it wrapped around to newer positions
+		int next = finder->prev[candidate & (LZ_WINDOW_SIZE - 1)];
+		if (next >= candidate) {
+			break;
+		}
+		candidate = next;
+	}
+
+	return bestLength >= LZ_MIN_MATCH ? bestLength : 0;
+}
+
+size_t maxCompressedLZSize(size_t dataSize) {
+	// Every byte as a literal plus a control byte for every 8 of them
+	return LZ_HEADER_SIZE + dataSize + (dataSize + 7) / 8;
+}
+
+int compressLZ(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize, int level) {
+	if (outputSize < LZ_HEADER_SIZE) {
+		return LZ_ERROR_OUTPUT_FULL;
+	}
+	if (level < LZ_LEVEL_FASTEST) {
+		level = LZ_LEVEL_FASTEST;
+	}
+	else if (level > LZ_LEVEL_BEST) {
+		level = LZ_LEVEL_BEST;
+	}
+
+	MatchFinder finder;
+	finder.input = input;
+	finder.inputSize = (int)inputSize;
+	finder.head = (int32_t*)malloc(sizeof(int32_t) * HASH_SIZE);
+	finder.prev = (int32_t*)malloc(sizeof(int32_t) * LZ_WINDOW_SIZE);
+	finder.level = compressionLevels[level];
+	for (int i = 0; i < HASH_SIZE; ++i) {
+		finder.head[i] = NO_POSITION;
+	}
+
+	uint8_t* out = output + LZ_HEADER_SIZE;
+	uint8_t* outEnd = output + outputSize;
+	int position = 0;
+	int inputLength = (int)inputSize;
+
+	// A match found by the lazy check that hasn't been used yet
+	bool haveMatch = false;
+	int length = 0;
+	int distance = 0;
+
+	// Room is checked for each byte as it's written, a reference is 2 bytes for at least 3 of input
+	// so output sized with maxCompressedLZSize is never too small
+	bool full = false;
+
+	while (position < inputLength && !full) {
+		if (out >= outEnd) {
+			full = true;
+			break;
+		}
+
+		// Control block, 1 bits are literals and 0 bits are references (read right to left)
+		uint8_t* block = out++;
+		uint8_t blockBits = 0;
+
+		for (int j = 0; j < 8 && position < inputLength; ++j) {
+			if (!haveMatch) {
+				length = findMatch(&finder, position, &distance);
+			}
+			haveMatch = false;
+
+			if (length != 0 && finder.level.lazy && length < finder.level.niceLength) {
+				// See if starting one byte later gives a longer match
+				int nextDistance = 0;
+				insertPosition(&finder, position);
+				int nextLength = findMatch(&finder, position + 1, &nextDistance);
+				if (nextLength > length) {
+					if (out >= outEnd) {
+						full = true;
+						break;
+					}
+					blockBits |= 1 << j;
+					*out++ = input[position++];
+					length = nextLength;
+					distance = nextDistance;
+					haveMatch = true;
+					continue;
+				}
+				for (int k = 1; k < length; ++k) {
+					insertPosition(&finder, position + k);
+				}
+			}
+			else {
+				for (int k = 0; k < (length != 0 ? length : 1); ++k) {
+					insertPosition(&finder, position + k);
+				}
+			}
+
+			if (outEnd - out < (length != 0 ? 2 : 1)) {
+				full = true;
+				break;
+			}
+			if (length != 0) {
+				// Offset is the position in the decoder's ring buffer (which starts 18 bytes from the end)
+				int offset = (position - LZ_MAX_MATCH - distance) & 0xFFF;
+				*out++ = (uint8_t)(offset & 0xFF);
+				*out++ = (uint8_t)(((offset >> 4) & 0xF0) | (length - LZ_MIN_MATCH));
+				position += length;
+			}
+			else {
+				blockBits |= 1 << j;
+				*out++ = input[position++];
+			}
+		}
+		*block = blockBits;
+	}
+
+	free(finder.head);
+	free(finder.prev);
+	if (full) {
+		return LZ_ERROR_OUTPUT_FULL;
+	}
+
+	// Header
+	uint32_t csize = (uint32_t)(out - output);
+	output[0] = (uint8_t)csize;
+	output[1] = (uint8_t)(csize >> 8);
+	output[2] = (uint8_t)(csize >> 16);
+	output[3] = (uint8_t)(csize >> 24);
+	output[4] = (uint8_t)inputSize;
+	output[5] = (uint8_t)(inputSize >> 8);
+	output[6] = (uint8_t)(inputSize >> 16);
+	output[7] = (uint8_t)(inputSize >> 24);
+
+	return (int)csize;
+}
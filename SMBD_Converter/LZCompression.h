@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+// SMB lz header: compressed size (including this header) followed by the decompressed size, both little endian
+#define LZ_HEADER_SIZE 8
+
+// The lzss window is 4KB and references are 3 to 18 bytes long
+#define LZ_WINDOW_SIZE 0x1000
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH 18
+
+// Compression levels, higher levels search further back for matches (slower but smaller output)
+#define LZ_LEVEL_FASTEST 1
+#define LZ_LEVEL_DEFAULT 6
+#define LZ_LEVEL_BEST 9
+
+// Error codes (returned as negative values)
+#define LZ_ERROR_HEADER -1
+#define LZ_ERROR_TRUNCATED -2
+#define LZ_ERROR_OUTPUT_FULL -3
+#define LZ_ERROR_INDEX -4
+#define LZ_ERROR_STOPPED -5
+
+// Reads the SMB lz header at the start of input
+// Returns 0 on success or LZ_ERROR_HEADER if input is too small/the compressed size is invalid/the data size is more than the compressed size could hold
+int readLZHeader(const uint8_t* input, size_t inputSize, uint32_t* compressedSize, uint32_t* dataSize);
+
+// Decompresses an SMB lz (header included) from input into output
+// output should be at least dataSize bytes (from the header)
+// Returns the number of bytes written to output or a negative LZ_ERROR_* value
+int decompressLZ(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize);
+
+// Decompresses only the first length bytes of an SMB lz into output (ie: everything before an offset, like a stage header)
+// Decoding stops as soon as they are there, so the cost depends on length instead of the file size
+// Returns the number of bytes written (less than length if the data is shorter) or a negative LZ_ERROR_* value
+int decompressLZPrefix(const uint8_t* input, size_t inputSize, uint8_t* output, size_t length);
+
+// Where a decoder is in an SMB lz, between two tokens (literals/references)
+typedef struct {
+	// Next byte to read, from the start of the lz (header included)
+	uint32_t inputPosition;
+	// Position in the decompressed data of the next byte decoded
+	uint32_t outputPosition;
+	// Control bits of the current block that weren't used yet (lowest bit next) and how many there are
+	uint8_t block;
+	uint8_t blockBits;
+}LZDecoderState;
+
+// Starts decoding at the beginning of the data
+void beginLZDecode(LZDecoderState* state);
+
+// Decodes from state until at least stop bytes of the data are there (or the data ends), stopping between two tokens
+// output holds outputSize bytes of the data starting at position outputBase
+// The 4KB before state->outputPosition have to be in output already unless they're before the start of the file (which reads as zeros)
+// A reference can end up to LZ_MAX_MATCH - 1 bytes past stop, so output needs that much room after it
+// Returns the number of bytes decoded (state->outputPosition is still before stop if the data ended) or a negative LZ_ERROR_* value
+int continueLZDecode(const uint8_t* input, size_t inputSize, LZDecoderState* state, uint8_t* output, uint32_t outputBase, size_t outputSize, uint32_t stop);
+
+// Largest amount of data compressedSize bytes (header included) can decompress to (every token a longest reference)
+uint64_t maxDecompressedLZSize(uint32_t compressedSize);
+
+// Size of the chunks streamLZ hands over
+#define LZ_STREAM_CHUNK_SIZE 0x10000
+
+// Receives decompressed data in order as it's decoded, returns false to stop decoding
+typedef std::function<bool(const uint8_t* data, size_t size)> LZSink;
+
+// Decompresses an SMB lz a chunk at a time, only keeping the 4KB window and the chunk being decoded (nothing is sized from the header)
+// Each chunk is given to sink as soon as it's decoded, every chunk but the last is chunkSize bytes
+// Decoding past the data size from the header is an error, like for decompressLZ
+// Returns the number of bytes decoded (less than the data size if the data ends early) or a negative LZ_ERROR_* value (LZ_ERROR_STOPPED if sink stopped it)
+int streamLZ(const uint8_t* input, size_t inputSize, size_t chunkSize, const LZSink& sink);
+
+// Largest possible size of a compressed file (header included) for dataSize bytes of input
+size_t maxCompressedLZSize(size_t dataSize);
+
+// Compresses input into an SMB lz (header included) in output
+// Use maxCompressedLZSize to size output
+// Returns the size of the compressed data or a negative LZ_ERROR_* value
+int compressLZ(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize, int level);
@@ -0,0 +1,180 @@
+#include "LZSeekIndex.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include "FunctionsAndDefines.h"
+
+// Sidecar format (little endian)
+// "LZIX", version, compressed size, data size, interval, checkpoint count
+// then each checkpoint (input position, output position, control block, control bits left, window)
+#define LZ_INDEX_MAGIC 0x58495A4C
+#define LZ_INDEX_VERSION 1
+#define LZ_INDEX_HEADER_SIZE 24
+#define LZ_CHECKPOINT_SIZE (16 + LZ_WINDOW_SIZE)
+
+int buildLZSeekIndex(const uint8_t* input, size_t inputSize, uint32_t interval, LZSeekIndex* index) {
+	uint32_t csize;
+	uint32_t dataSize;
+	if (readLZHeader(input, inputSize, &csize, &dataSize) != 0) {
+		return LZ_ERROR_HEADER;
+	}
+	// Closer than a window apart the checkpoints would be bigger than the data between them
+	if (interval < LZ_WINDOW_SIZE) {
+		interval = LZ_WINDOW_SIZE;
+	}
+	index->compressedSize = csize;
+	index->dataSize = dataSize;
+	index->interval = interval;
+	index->checkpoints.clear();
+
+	// The window and the interval being decoded (buffer[0] is position base)
+	std::vector<uint8_t> buffer(LZ_WINDOW_SIZE + interval + LZ_MAX_MATCH);
+	uint32_t base = 0;
+	LZDecoderState state;
+	beginLZDecode(&state);
+
+	for (uint64_t stop = interval; stop < dataSize; stop += interval) {
+		int decoded = continueLZDecode(input, inputSize, &state, buffer.data(), base, buffer.size(), (uint32_t)stop);
+		if (decoded < 0) {
+			return decoded;
+		}
+		// Data ended early (or right at the checkpoint, which would never be used)
+		if (state.outputPosition < stop || state.outputPosition >= dataSize) {
+			break;
+		}
+
+		// References can overshoot stop a little, the checkpoint is where the decoder actually is
+		LZCheckpoint checkpoint;
+		checkpoint.state = state;
+		uint32_t windowStart = state.outputPosition - LZ_WINDOW_SIZE;
+		memcpy(checkpoint.window, &buffer[windowStart - base], LZ_WINDOW_SIZE);
+		index->checkpoints.push_back(checkpoint);
+
+		// Only the window is needed to keep going
+		memmove(buffer.data(), &buffer[windowStart - base], LZ_WINDOW_SIZE);
+		base = windowStart;
+	}
+	return (int)index->checkpoints.size();
+}
+
+bool lzSeekIndexMatches(const LZSeekIndex* index, const uint8_t* input, size_t inputSize) {
+	uint32_t csize;
+	uint32_t dataSize;
+	return readLZHeader(input, inputSize, &csize, &dataSize) == 0 && csize == index->compressedSize && dataSize == index->dataSize;
+}
+
+const LZCheckpoint* findLZCheckpoint(const LZSeekIndex* index, uint32_t offset) {
+	if (index == NULL) {
+		return NULL;
+	}
+	// First checkpoint past offset
+	std::vector<LZCheckpoint>::const_iterator checkpoint = std::upper_bound(index->checkpoints.begin(), index->checkpoints.end(), offset,
+		[](uint32_t value, const LZCheckpoint &checkpoint) { return value < checkpoint.state.outputPosition; });
+	if (checkpoint == index->checkpoints.begin()) {
+		return NULL;
+	}
+	return &*(checkpoint - 1);
+}
+
+int decompressLZRange(const uint8_t* input, size_t inputSize, const LZSeekIndex* index, uint32_t offset, uint8_t* output, uint32_t length) {
+	uint32_t csize;
+	uint32_t dataSize;
+	if (readLZHeader(input, inputSize, &csize, &dataSize) != 0) {
+		return LZ_ERROR_HEADER;
+	}
+	if (index != NULL && !lzSeekIndexMatches(index, input, inputSize)) {
+		return LZ_ERROR_INDEX;
+	}
+	if (offset >= dataSize || length == 0) {
+		return 0;
+	}
+	uint32_t end = dataSize - offset < length ? dataSize : offset + length;
+
+	// Everything from the checkpoint's window up to end (buffer[0] is position base)
+	LZDecoderState state;
+	uint32_t base = 0;
+	std::vector<uint8_t> buffer;
+	const LZCheckpoint* checkpoint = findLZCheckpoint(index, offset);
+	if (checkpoint != NULL) {
+		state = checkpoint->state;
+		base = state.outputPosition - LZ_WINDOW_SIZE;
+		buffer.resize(end - base + LZ_MAX_MATCH);
+		memcpy(buffer.data(), checkpoint->window, LZ_WINDOW_SIZE);
+	}
+	else {
+		beginLZDecode(&state);
+		buffer.resize(end + LZ_MAX_MATCH);
+	}
+
+	int decoded = continueLZDecode(input, inputSize, &state, buffer.data(), base, buffer.size(), end);
+	if (decoded < 0) {
+		return decoded;
+	}
+
+	// The data can end before the header says it does
+	uint32_t available = state.outputPosition < end ? state.outputPosition : end;
+	if (available <= offset) {
+		return 0;
+	}
+	memcpy(output, &buffer[offset - base], available - offset);
+	return (int)(available - offset);
+}
+
+void saveLZSeekIndex(const LZSeekIndex* index, std::vector<uint8_t>* output) {
+	output->clear();
+	output->reserve(LZ_INDEX_HEADER_SIZE + index->checkpoints.size() * LZ_CHECKPOINT_SIZE);
+	OutputStream stream = { output, 0 };
+	writeLittleInt(&stream, LZ_INDEX_MAGIC);
+	writeLittleInt(&stream, LZ_INDEX_VERSION);
+	writeLittleInt(&stream, index->compressedSize);
+	writeLittleInt(&stream, index->dataSize);
+	writeLittleInt(&stream, index->interval);
+	writeLittleInt(&stream, (uint32_t)index->checkpoints.size());
+
+	for (size_t i = 0; i < index->checkpoints.size(); ++i) {
+		const LZCheckpoint* checkpoint = &index->checkpoints[i];
+		writeLittleInt(&stream, checkpoint->state.inputPosition);
+		writeLittleInt(&stream, checkpoint->state.outputPosition);
+		writeLittleInt(&stream, checkpoint->state.block);
+		writeLittleInt(&stream, checkpoint->state.blockBits);
+		output->insert(output->end(), checkpoint->window, checkpoint->window + LZ_WINDOW_SIZE);
+		stream.position += LZ_WINDOW_SIZE;
+	}
+}
+
+bool loadLZSeekIndex(const uint8_t* data, size_t size, LZSeekIndex* index) {
+	InputStream stream = { data, size, 0 };
+	if (size < LZ_INDEX_HEADER_SIZE || readLittleInt(&stream) != LZ_INDEX_MAGIC || readLittleInt(&stream) != LZ_INDEX_VERSION) {
+		return false;
+	}
+	index->compressedSize = readLittleInt(&stream);
+	index->dataSize = readLittleInt(&stream);
+	index->interval = readLittleInt(&stream);
+	uint32_t count = readLittleInt(&stream);
+	if ((uint64_t)count * LZ_CHECKPOINT_SIZE != size - LZ_INDEX_HEADER_SIZE) {
+		return false;
+	}
+
+	index->checkpoints.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		LZCheckpoint* checkpoint = &index->checkpoints[i];
+		checkpoint->state.inputPosition = readLittleInt(&stream);
+		checkpoint->state.outputPosition = readLittleInt(&stream);
+		uint32_t block = readLittleInt(&stream);
+		uint32_t blockBits = readLittleInt(&stream);
+		// Positions only go forward and a checkpoint always has a whole window before it
+		if (block > 0xFF || blockBits > 8 || checkpoint->state.inputPosition < LZ_HEADER_SIZE || checkpoint->state.inputPosition > index->compressedSize
+			|| checkpoint->state.outputPosition < LZ_WINDOW_SIZE || checkpoint->state.outputPosition >= index->dataSize
+			|| (i > 0 && checkpoint->state.outputPosition <= index->checkpoints[i - 1].state.outputPosition)) {
+			return false;
+		}
+		checkpoint->state.block = (uint8_t)block;
+		checkpoint->state.blockBits = (uint8_t)blockBits;
+		memcpy(checkpoint->window, &data[stream.position], LZ_WINDOW_SIZE);
+		stream.position += LZ_WINDOW_SIZE;
+	}
+	return true;
+}
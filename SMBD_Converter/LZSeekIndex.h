@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "LZCompression.h"
+
+// Decoder checkpoints of an SMB lz, so part of it can be decoded without decoding everything before it
+// References reach at most 4KB back, so a checkpoint is the decoder state plus the 4KB decoded before it
+// Saved next to the lz as a sidecar file (<file.lz>.index)
+
+// Default distance between checkpoints (each one is a little over 4KB)
+#define LZ_SEEK_INTERVAL_DEFAULT 0x10000
+
+typedef struct {
+	LZDecoderState state;
+	// The data from state.outputPosition - LZ_WINDOW_SIZE up to state.outputPosition
+	uint8_t window[LZ_WINDOW_SIZE];
+}LZCheckpoint;
+
+typedef struct {
+	// From the lz header, an index is only used with the file it was built from
+	uint32_t compressedSize;
+	uint32_t dataSize;
+	uint32_t interval;
+	// By position, the first one is at (or just after) interval
+	std::vector<LZCheckpoint> checkpoints;
+}LZSeekIndex;
+
+// Decodes input once, saving a checkpoint every interval bytes (at least LZ_WINDOW_SIZE apart)
+// Only the window and one interval of the data are kept in memory
+// Returns the number of checkpoints or a negative LZ_ERROR_* value
+int buildLZSeekIndex(const uint8_t* input, size_t inputSize, uint32_t interval, LZSeekIndex* index);
+
+// True if index was built from an lz with the same header as input
+bool lzSeekIndexMatches(const LZSeekIndex* index, const uint8_t* input, size_t inputSize);
+
+// Last checkpoint at or before offset, or NULL if decoding has to start at the beginning
+const LZCheckpoint* findLZCheckpoint(const LZSeekIndex* index, uint32_t offset);
+
+// Decodes bytes [offset, offset + length) of input's data into output, starting at the closest checkpoint before offset
+// index can be NULL to decode from the start
+// Returns the number of bytes written (less than length past the end of the data) or a negative LZ_ERROR_* value
+// (LZ_ERROR_INDEX if index was built from another file)
+int decompressLZRange(const uint8_t* input, size_t inputSize, const LZSeekIndex* index, uint32_t offset, uint8_t* output, uint32_t length);
+
+// Saves index as a sidecar file
+void saveLZSeekIndex(const LZSeekIndex* index, std::vector<uint8_t>* output);
+
+// Reads an index saved by saveLZSeekIndex, returns false if data isn't one
+bool loadLZSeekIndex(const uint8_t* data, size_t size, LZSeekIndex* index);
@@ -4,13 +4,23 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <stdint.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "RawLZConverter.h"
 #include "TPLConverter.h"
 #include "GMAConverter.h"
+#include "LZCompression.h"
+#include "LZSeekIndex.h"
 #include "FunctionsAndDefines.h"
+#include "BatchConverter.h"
+#include "InputSource.h"
+#include "StageGraph.h"
 
 typedef struct {
 	uint32_t encoding;
@@ -45,10 +55,106 @@ typedef struct {
 
 int decompress(const char* filename);
 
+bool isDirectory(const char* path);
+
+int compress(const char* filename, int level);
+
+int convertLZ(const char* filename, bool recompress, int level);
+
+int graphStage(const char* filename);
+
+int indexLZ(const char* filename, uint32_t interval);
+
 int main(int argc, char*argv[]) {
 	if (argc == 1) {
 		return 0;
 	}
+
+	// -catalog <files/directories...>: Print the item counts of every stage from just its header
+	if (std::string(argv[1]) == "-catalog") {
+		if (argc < 3) {
+			printf("Usage: %s -catalog <files/directories...>\n", argv[0]);
+			return 0;
+		}
+		catalogStages(std::vector<std::string>(argv + 2, argv + argc));
+		return 0;
+	}
+
+	// -compress <file> [level]: Compress any file to <file>.lz
+	if (std::string(argv[1]) == "-compress") {
+		if (argc < 3) {
+			printf("Usage: %s -compress <file> [level 1-9]\n", argv[0]);
+			return 0;
+		}
+		int level = argc > 3 ? atoi(argv[3]) : LZ_LEVEL_DEFAULT;
+		return compress(argv[2], level) == 0 ? 0 : 1;
+	}
+
+	// -graph <raw lz>: Save the pointer graph of a stage to <file>.graph
+	if (std::string(argv[1]) == "-graph") {
+		if (argc < 3) {
+			printf("Usage: %s -graph <raw lz>\n", argv[0]);
+			return 0;
+		}
+		return graphStage(argv[2]) == 0 ? 0 : 1;
+	}
+
+	// -index <file.lz> [interval KB]: Save decoder checkpoints to <file.lz>.index so parts of it can be decoded on their own
+	if (std::string(argv[1]) == "-index") {
+		if (argc < 3) {
+			printf("Usage: %s -index <file.lz> [interval KB]\n", argv[0]);
+			return 0;
+		}
+		uint32_t interval = argc > 3 ? (uint32_t)atoi(argv[3]) * 1024 : LZ_SEEK_INTERVAL_DEFAULT;
+		return indexLZ(argv[2], interval) == 0 ? 0 : 1;
+	}
+
+	// -pipeline <file.lz> [-lz [level]]: Decompress, convert and optionally recompress a stage without intermediate files
+	if (std::string(argv[1]) == "-pipeline") {
+		if (argc < 3) {
+			printf("Usage: %s -pipeline <file.lz> [-lz [level 1-9]]\n", argv[0]);
+			return 0;
+		}
+		bool recompress = argc > 3 && std::string(argv[3]) == "-lz";
+		int level = argc > 4 ? atoi(argv[4]) : LZ_LEVEL_DEFAULT;
+		return convertLZ(argv[2], recompress, level) == 0 ? 0 : 1;
+	}
+
+	// -batch [-j threads] [-lz [level]] [-inplace] <files/directories...>: Convert everything on a thread pool
+	// Dragging more than one file (or a directory) onto the executable does the same
+	if (std::string(argv[1]) == "-batch" || argc > 2 || isDirectory(argv[1])) {
+		BatchOptions options;
+		options.threadCount = 0;
+		options.recompress = false;
+		options.compressionLevel = LZ_LEVEL_DEFAULT;
+		options.inPlace = false;
+
+		std::vector<std::string> paths;
+		for (int i = std::string(argv[1]) == "-batch" ? 2 : 1; i < argc; ++i) {
+			std::string arg(argv[i]);
+			if (arg == "-j" && i + 1 < argc) {
+				options.threadCount = atoi(argv[++i]);
+			}
+			else if (arg == "-inplace") {
+				options.inPlace = true;
+			}
+			else if (arg == "-lz") {
+				options.recompress = true;
+				if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9') {
+					options.compressionLevel = atoi(argv[++i]);
+				}
+			}
+			else {
+				paths.push_back(arg);
+			}
+		}
+		if (paths.empty()) {
+			printf("Usage: %s -batch [-j threads] [-lz [level 1-9]] [-inplace] <files/directories...>\n", argv[0]);
+			return 0;
+		}
+		return convertBatch(paths, &options) == 0 ? 0 : 1;
+	}
+
 	std::string filenameParam(argv[1]);
 
 	std::string fileType = filenameParam.substr(filenameParam.length() - 3, 3);
@@ -64,7 +170,7 @@ int main(int argc, char*argv[]) {
 	}
 	else if (fileType == ".lz") {
 		if (decompress(filenameParam.c_str()) == 0) {
-			filenameParam += ".raw" + '\0';
+			filenameParam += ".raw";
 			parseRawLZ(filenameParam.c_str());
 		}
 	}
@@ -73,33 +179,27 @@ int main(int argc, char*argv[]) {
 	
 }
 
+bool isDirectory(const char* path) {
+	struct stat info;
+	return stat(path, &info) == 0 && (info.st_mode & S_IFMT) == S_IFDIR;
+}
+
 int decompress(const char* filename) {
-	// Try to open it
-	FILE* lz = fopen(filename, "rb");
-	if (lz == NULL) {
+	// Try to open it (the whole lz is mapped and decoded in memory)
+	InputSource lz;
+	if (!openInputSource(&lz, filename)) {
 		printf("ERROR: File not found: %s\n", filename);
 		return -1;
 	}
 	printf("Decompressing %s\n", filename);
 
-	// Create a temp file for the unfixed lz (SMB lz has a slightly different header than FF7 LZS)
-	FILE* normal = tmpfile();
-
-	// Unfix the header (Turn it back into normal FF7 LZSS)
-	uint32_t csize = readLittleInt(lz) - 8;
 	// Filesize of the uncompressed data
-	int dataSize = readLittleInt(lz);
-	putc(csize & 0xFF, normal);
-	putc((csize >> 8) & 0xFF, normal);
-	putc((csize >> 16) & 0xFF, normal);
-	putc((csize >> 24) & 0xFF, normal);
-	for (int j = 0; j < (int)(csize); j++) {
-		char c = (char)getc(lz);
-		putc(c, normal);
-	}
-	fclose(lz);
-	fflush(normal);
-	fseek(normal, 0, SEEK_SET);
+	uint32_t csize;
+	uint32_t dataSize;
+	if (readLZHeader(lz.data, lz.size, &csize, &dataSize) != 0) {
+		printf("ERROR: Invalid lz header: %s\n", filename);
+		return -1;
+	}
 
 	// Make the output file name
 	char outfileName[512];
@@ -113,87 +213,166 @@ int decompress(const char* filename) {
 		outfileName[nameLength++] = '\0';
 	}
 
-	// The size the the lzss data + 4 bytes for the header
-	uint32_t filesize = readLittleInt(normal) + 4;
+	FILE* outfile = fopen(outfileName, "wb");
+	if (outfile == NULL) {
+		printf("ERROR: Failed to open file: %s\n", outfileName);
+		closeInputSource(&lz);
+		return -1;
+	}
 
-	char * memBlock = (char*)malloc(sizeof(char) * (dataSize));
-	int memPosition = 0;
+	// Each chunk is written as soon as it's decoded, so memory use doesn't depend on the file size
+	adviseInputSource(&lz, INPUT_ACCESS_SEQUENTIAL);
+	int decoded = streamLZ(lz.data, lz.size, LZ_STREAM_CHUNK_SIZE, [outfile](const uint8_t* data, size_t size) {
+		return fwrite(data, sizeof(uint8_t), size, outfile) == size;
+	});
+	closeInputSource(&lz);
 
-	// Loop until we reach the end of the data or end of the file
-	while ((unsigned)ftell(normal) < filesize && !feof(normal)) {
+	if (decoded < 0) {
+		if (decoded == LZ_ERROR_STOPPED) {
+			printf("ERROR: Failed to write file: %s\n", outfileName);
+		}
+		else {
+			printf("ERROR: Failed to decompress %s (%d)\n", filename, decoded);
+		}
+		fclose(outfile);
+		remove(outfileName);
+		return -1;
+	}
 
-		// Read the first control block
-		// Read right to left, each bit specifies how the the next 8 spots of data will be
-		// 0 means write the byte directly to the output
-		// 1 represents there will be reference (2 byte)
-		uint8_t block = (uint8_t)getc(normal);
+	// Anything the stream doesn't cover is left as zeros
+	static const uint8_t zeros[0x1000] = { 0 };
+	for (uint32_t position = (uint32_t)decoded; position < dataSize; position += sizeof(zeros)) {
+		uint32_t length = dataSize - position < sizeof(zeros) ? dataSize - position : (uint32_t)sizeof(zeros);
+		fwrite(zeros, sizeof(uint8_t), length, outfile);
+	}
+	fclose(outfile);
 
-		// Go through every bit in the control block
-		for (int j = 0; j < 8 && (unsigned)ftell(normal) < filesize && !feof(normal); ++j) {
-			// Literal byte copy
-			if (block & 0x01) {
-				memBlock[memPosition] = (char)getc(normal);
-				++memPosition;
-			}// Reference
-			else {
-				uint16_t reference = readBigShort(normal);
-
-				// Length is the last four bits + 3
-				// Any less than a lengh of 3 i pointess since a reference takes up 3 bytes
-				// Length is the last nibble (last 4 bits) of the 2 reference bytes
-				int length = (reference & 0x000F) + 3;
-
-				// Offset if is all 8 bits in the first reference byte and the first nibble (4 bits) in the second reference byte
-				// The nibble from the second reference byte comes before the first reference byte
-				// EX: reference bytes = 0x12 0x34
-				//     offset = 0x312
-				int offset = ((reference & 0xFF00) >> 8) | ((reference & 0x00F0) << 4);
-
-				// Convert the offset to how many bytes away from the end of the buffer to start reading from
-				int backSet = (memPosition - 18 - offset) & 0xFFF;
-
-				// Calculate the actual location in the file
-				int readLocation = memPosition - backSet;
-
-				// Handle case where the offset is past the beginning of the file
-				if (readLocation < 0) {
-					// Determine how many zeros to write
-					int amt = -readLocation;
-					if (length <= amt) {
-						amt = length;
-					}
-					// Write the zeros
-					memset(&memBlock[memPosition], 0, sizeof(char) * amt);
-					// Ajuest positions and number of bytes left to copy
-					length -= amt;
-					readLocation += amt;
-					memPosition += amt;
-				}
+	printf("Finished Decompressing %s\n", filename);
+	return 0;
+}
 
-				// Copy the rest of the reference bytes
-				while (length-- > 0) {
-					memBlock[memPosition++] = memBlock[readLocation++];
-				}
+int compress(const char* filename, int level) {
+	InputSource raw;
+	if (!openInputSource(&raw, filename)) {
+		printf("ERROR: File not found: %s\n", filename);
+		return -1;
+	}
+	printf("Compressing %s\n", filename);
 
+	size_t lzCapacity = maxCompressedLZSize(raw.size);
+	uint8_t* lzBlock = (uint8_t*)malloc(lzCapacity);
+	adviseInputSource(&raw, INPUT_ACCESS_SEQUENTIAL);
+	int compressed = compressLZ(raw.data, raw.size, lzBlock, lzCapacity, level);
+	closeInputSource(&raw);
 
-			}
-			// Go to the next reference bit in the block
-			block = block >> 1;
-		}
+	if (compressed < 0) {
+		printf("ERROR: Failed to compress %s (%d)\n", filename, compressed);
+		free(lzBlock);
+		return -1;
+	}
 
+	std::string outfileName = std::string(filename) + ".lz";
+	FILE* outfile = fopen(outfileName.c_str(), "wb");
+	if (outfile == NULL) {
+		printf("ERROR: Failed to open file: %s\n", outfileName.c_str());
+		free(lzBlock);
+		return -1;
+	}
+	fwrite(lzBlock, sizeof(uint8_t), compressed, outfile);
+	fclose(outfile);
+	free(lzBlock);
 
+	printf("Finished Compressing %s\n", filename);
+	return 0;
+}
+
+int graphStage(const char* filename) {
+	InputSource raw;
+	if (!openInputSource(&raw, filename)) {
+		printf("ERROR: File not found: %s\n", filename);
+		return -1;
 	}
 
-	// Open the output file and copy the data into it
-	FILE* outfile = fopen(outfileName, "wb");
-	fwrite(memBlock, sizeof(char), dataSize, outfile);
+	StageGraph graph;
+	adviseInputSource(&raw, INPUT_ACCESS_SPARSE);
+	int game = buildStageGraph(raw.data, (uint32_t)raw.size, -1, &graph);
+	closeInputSource(&raw);
+	if (game == -1) {
+		printf("ERROR: Not a raw lz stage: %s\n", filename);
+		return -1;
+	}
 
-	// Close files and free memory
-	free(memBlock);
+	std::vector<uint8_t> sidecar;
+	saveStageGraph(&graph, &sidecar);
+	std::string outfileName = std::string(filename) + ".graph";
+	FILE* outfile = fopen(outfileName.c_str(), "wb");
+	if (outfile == NULL) {
+		printf("ERROR: Failed to open file: %s\n", outfileName.c_str());
+		return -1;
+	}
+	fwrite(sidecar.data(), sizeof(uint8_t), sidecar.size(), outfile);
 	fclose(outfile);
-	fclose(normal);
 
-	printf("Finished Decompressing %s\n", filename);
+	printf("%s: %d regions, %d pointers\n", filename, (int)graph.nodes.size(), (int)graph.edges.size());
+	return 0;
+}
+
+int indexLZ(const char* filename, uint32_t interval) {
+	InputSource lz;
+	if (!openInputSource(&lz, filename)) {
+		printf("ERROR: File not found: %s\n", filename);
+		return -1;
+	}
+
+	LZSeekIndex index;
+	adviseInputSource(&lz, INPUT_ACCESS_SEQUENTIAL);
+	int checkpoints = buildLZSeekIndex(lz.data, lz.size, interval, &index);
+	closeInputSource(&lz);
+	if (checkpoints < 0) {
+		printf("ERROR: Failed to decompress %s (%d)\n", filename, checkpoints);
+		return -1;
+	}
+
+	std::vector<uint8_t> sidecar;
+	saveLZSeekIndex(&index, &sidecar);
+	std::string outfileName = std::string(filename) + ".index";
+	FILE* outfile = fopen(outfileName.c_str(), "wb");
+	if (outfile == NULL) {
+		printf("ERROR: Failed to open file: %s\n", outfileName.c_str());
+		return -1;
+	}
+	fwrite(sidecar.data(), sizeof(uint8_t), sidecar.size(), outfile);
+	fclose(outfile);
+
+	printf("%s: %d checkpoints every %uKB\n", filename, checkpoints, index.interval / 1024);
+	return 0;
+}
+
+int convertLZ(const char* filename, bool recompress, int level) {
+	ConversionContext context;
+	initConversionContext(&context, filename);
+	context.recompress = recompress;
+	context.compressionLevel = level;
+	context.pool = createWorkPool(0);
+
+	if (!loadInputFile(&context)) {
+		destroyWorkPool(context.pool);
+		printDiagnostics(&context);
+		return -1;
+	}
+	printf("Converting %s\n", filename);
+
+	if (convertLZ(&context) == 0) {
+		std::string outfileName = convertedFilename(&context) + (recompress ? ".lz" : "");
+		writeOutputFile(&context, outfileName, outputData(&context), outputSize(&context));
+	}
+	destroyWorkPool(context.pool);
+	printDiagnostics(&context);
+	if (hasErrors(&context)) {
+		return -1;
+	}
+
+	printf("Finished Converting %s\n", filename);
 	return 0;
 }
 
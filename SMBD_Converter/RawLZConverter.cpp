@@ -6,1540 +6,1647 @@
 #include "RawLZConverter.h"
 
 #include "FunctionsAndDefines.h"
+#include "StageSchemas.h"
+#include "StageModel.h"
+#include "StageGraph.h"
+#include "StagePlan.h"
+#include "LZCompression.h"
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <errno.h>
+#include <string.h>
 
 
-static void copyAsciiAligned(FILE *input, FILE *output, uint32_t offset) {
-	if (offset == 0) return;
-	uint32_t savePos = ftell(input);
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
+// Bytes [start, end) of the converted image
+typedef struct {
+	uint32_t start;
+	uint32_t end;
+}StageRegion;
 
-	// Copy characters until at the end of file
-	// or at the end of the ascii and 4 byte aligned
-	int c;
-	do {
-		c = getc(input);
-		if (c == EOF) {
-			break;
-		}
-		putc(c, output);
-	} while (!feof(input) && !(c == 0 && ftell(input) % 4 == 0));
+// A converted region of the stage, keyed by its start in VisitedMap
+typedef struct {
+	uint32_t end;
+	// Where the records start (parts cut off a region keep lining up with the original records)
+	uint32_t origin;
+	const RecordSchema *schema;
+}VisitedRegion;
 
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
-}
+// Bytes [start, end) converted as two different layouts
+typedef struct {
+	uint32_t start;
+	uint32_t end;
+	const RecordSchema *first;
+	const RecordSchema *second;
+}StageConflict;
+
+// What every converted byte of the stage was last converted as
+// Lets shared data (ie: lists the collision fields duplicate from the header) be converted once
+// and catches data read with two different layouts
+typedef struct {
+	std::mutex lock;
+	std::map<uint32_t, VisitedRegion> regions;
+	std::vector<StageConflict> conflicts;
+}VisitedMap;
+
+// How much of a stage that is still being decompressed is there so far
+// The decoder publishes it after every chunk, conversion waits on it before reading anything past it
+typedef struct {
+	std::mutex lock;
+	std::condition_variable changed;
+	std::atomic<uint32_t> decoded;
+	// Set once decoding stopped (anything past decoded then stays zeros)
+	bool finished;
+}DecodeWatermark;
+
+// Stage graph being built by a walk
+typedef struct {
+	// Offsets read so far that no region was visited at yet (value, field offset)
+	// Not every int read is a pointer, the ones that aren't just never match a region
+	std::multimap<uint32_t, uint32_t> pointers;
+	// Node of every region visited, by start and schema
+	std::map<std::pair<uint32_t, const RecordSchema*>, uint32_t> nodeIndex;
+	std::vector<StageNode> nodes;
+	// from is filled in once every node is known
+	std::vector<StageEdge> edges;
+}GraphBuilder;
+
+// Position in a stage image being converted
+// Fields are read from original and written to the same offset in converted
+typedef struct {
+	const uint8_t *original;
+	uint8_t *converted;
+	uint32_t size;
+	uint32_t position;
+	// Independent parts are converted as tasks on this pool (NULL = all on this thread)
+	WorkPool *pool;
+	// Regions written while converting (NULL = not tracked)
+	std::vector<StageRegion> *written;
+	// Regions converted so far (NULL = convert everything every time)
+	VisitedMap *visited;
+	// Stage to add every newly visited region to (NULL if not reading one)
+	// converted is NULL when only reading a stage
+	Stage *model;
+	// Graph to add every visited region and the pointers to it to (NULL if not building one, the walk is then on one thread)
+	GraphBuilder *graph;
+	// Every byte read to find the records (NULL = not recorded, the walk is then on one thread)
+	std::vector<StageRegion> *reads;
+	// Decoder of the stage when it's converted while still being decompressed (NULL = everything is there)
+	DecodeWatermark *decoding;
+	// How much was decoded the last time decoding was checked
+	uint32_t decoded;
+}StageCursor;
 
 typedef struct {
 	int number;
 	int offset;
 }Item;
 
+static void initDecodeWatermark(DecodeWatermark *decoding) {
+	decoding->decoded = 0;
+	decoding->finished = false;
+}
 
-static void copyAnimation(FILE *input, FILE *output, uint32_t offset, int numKeys, int minLength);
-
-static void copyBackgroundAnimation(FILE *input, FILE *output, uint32_t offset, int numKeys, int minLength);
-
-static void copyEffects(FILE *input, FILE *output, uint32_t offset);
-static void copyEffectOne(FILE *input, FILE *output, Item item);
-static void copyEffectTwo(FILE *input, FILE *output, Item item);
-static void copyTextureScroll(FILE *input, FILE *output, uint32_t offset);
-
-static uint32_t copyCollisionTriangleGrid(FILE *input, FILE *output, uint32_t offset, uint32_t xStepCount, uint32_t zStepCount);
-
-static void copyCollisionTriangles(FILE *input, FILE *output, uint32_t offset, uint32_t maxIndex);
-
-static Item readItem(FILE *input, FILE *output);
-
-static void copyStartPositions(FILE *original, FILE *converted, Item item);
-static void copyFalloutY(FILE *original, FILE *converted, Item item);
-static void copyGoals(FILE *original, FILE *converted, Item item);
-static void copyBumpers(FILE *original, FILE *converted, Item item);
-static void copyJamabars(FILE *original, FILE *converted, Item item);
-static void copyBananas(FILE *original, FILE *converted, Item item);
-static void copyConeCollisions(FILE *original, FILE *converted, Item item);
-static void copyCylinderCollisions(FILE *original, FILE *converted, Item item);
-static void copySphereCollisions(FILE *original, FILE *converted, Item item);
-static void copyFalloutVolumes(FILE *original, FILE *converted, Item item);
-static void copyBackgroundModels(FILE *original, FILE *converted, Item item);
-static void copyMysteryEights(FILE *original, FILE *converted, Item item);
-static void copyMysteryTwelves(FILE *original, FILE *converted, Item item);
-static void copyMysteryFourteens(FILE *original, FILE *converted, Item item);
-static void copyMysteryFifteens(FILE *original, FILE *converted, Item item);
-static void copyReflectiveModels(FILE *original, FILE *converted, Item item);
-static void copyModelDuplicates(FILE *original, FILE *converted, Item item);
-static void copyLevelModelAs(FILE *original, FILE *converted, Item item);
-static void copyLevelModelBs(FILE *original, FILE *converted, Item item);
-static void copySwitches(FILE *original, FILE *converted, Item item);
-static void copyFogAnimation(FILE *original, FILE *converted, Item item);
-static void copyWormholes(FILE *original, FILE *converted, Item item);
-static void copyFog(FILE *original, FILE *converted, Item item);
-static void copyMysteryThrees(FILE *original, FILE *converted, Item item);
-static void copyMysteryFive(FILE *original, FILE *converted, Item item);
-static void copyMysteryElevens(FILE *original, FILE *converted, Item item);
-static void copyCollisionFields(FILE *original, FILE *converted, Item item);
-
-
-// Using function pointers to read/write values keeps things game agnostic (can convert from SMBD to SMB2 or SMB2 to SMBD)
-static uint32_t(*readInt)(FILE*);
-static void(*writeInt)(FILE*, uint32_t);
-static void(*writeNormalInt)(FILE*, uint32_t);
-
-static uint16_t(*readShort)(FILE*);
-static void(*writeShort)(FILE*, uint16_t);
-static void(*writeNormalShort)(FILE*, uint16_t);
-
-
-void parseRawLZ(const char* filename) {
-	int game = 0;
+static void publishDecoded(DecodeWatermark *decoding, uint32_t decoded, bool finished) {
+	{
+		std::lock_guard<std::mutex> guard(decoding->lock);
+		decoding->decoded.store(decoded, std::memory_order_release);
+		decoding->finished = finished;
+	}
+	decoding->changed.notify_all();
+}
 
+// Blocks until the bytes before end are decoded
+// Returns how much is decoded (everything once decoding finished, even if it ended early)
+static uint32_t waitDecoded(DecodeWatermark *decoding, uint32_t end) {
+	uint32_t decoded = decoding->decoded.load(std::memory_order_acquire);
+	if (decoded >= end) {
+		return decoded;
+	}
+	std::unique_lock<std::mutex> guard(decoding->lock);
+	while (!decoding->finished && decoding->decoded.load(std::memory_order_acquire) < end) {
+		decoding->changed.wait(guard);
+	}
+	return decoding->finished ? 0xFFFFFFFF : decoding->decoded.load(std::memory_order_acquire);
+}
 
-	std::string outfilename = std::string(filename);
+// Waits for the bytes before end when the stage is still being decompressed
+static inline void waitForStage(StageCursor *stage, uint32_t end) {
+	if (stage->decoding != NULL && end > stage->decoded) {
+		stage->decoded = waitDecoded(stage->decoding, end);
+	}
+}
 
-	FILE *original = fopen(filename, "rb");
+static inline bool inStage(StageCursor *stage, uint32_t position, uint32_t length) {
+	return (uint64_t)position + length <= stage->size;
+}
 
-	if (original == NULL) {
-		printf("Error opening file: %s\n", filename);
+static inline void markWritten(StageCursor *stage, uint32_t position, uint32_t length) {
+	if (stage->written == NULL) return;
+	std::vector<StageRegion> &written = *stage->written;
+	// Lists are converted in order so most writes extend the last region
+	if (!written.empty() && written.back().end == position) {
+		written.back().end += length;
 		return;
 	}
+	StageRegion region = { position, position + length };
+	written.push_back(region);
+}
 
-	fseek(original, 4, SEEK_SET);
-
-	// Determine which game the raw lz is from and set function pointers/vars accordingly
-	if (getc(original) == 0) {
-		game = SMBD;
-		outfilename += ".smb2";
-		readInt = &readLittleInt;
-		readShort = &readLittleShort;
-
-		writeInt = &writeBigInt;
-		writeShort = &writeBigShort;
+// Bytes the walk depends on, a stage with the same bytes there is walked the same way
+static inline void markRead(StageCursor *stage, uint32_t position, uint32_t length) {
+	if (stage->reads == NULL || length == 0) return;
+	std::vector<StageRegion> &reads = *stage->reads;
+	if (!reads.empty() && reads.back().end == position) {
+		reads.back().end += length;
+		return;
+	}
+	StageRegion region = { position, position + length };
+	reads.push_back(region);
+}
 
-		writeNormalInt = &writeLittleInt;
-		writeNormalShort = &writeLittleShort;
+// How a byte at offset in a record is converted: 1 = copied, otherwise width * 16 + byte in the field
+static uint32_t schemaByteKind(const RecordSchema *schema, uint32_t offset) {
+	for (uint32_t i = 0; i < schema->fieldCount; ++i) {
+		const FieldSchema *field = &schema->fields[i];
+		uint32_t fieldEnd = field->offset + field->count * field->width;
+		if (offset >= field->offset && offset < fieldEnd) {
+			return field->swap ? field->width * 16 + (offset - field->offset) % field->width : 1;
+		}
 	}
-	else {
-		game = SMB2;
-		outfilename += ".smbd";
-		readInt = &readBigInt;
-		readShort = &readBigShort;
+	return 0;
+}
 
-		writeInt = &writeLittleInt;
-		writeShort = &writeLittleShort;
+// True if [start, end) of region is converted the same way as records of schema starting at origin
+static bool sameLayout(const VisitedRegion *region, const RecordSchema *schema, uint32_t origin, uint32_t start, uint32_t end) {
+	uint32_t regionPhase = (start - region->origin) % region->schema->size;
+	uint32_t phase = (start - origin) % schema->size;
+	if (region->schema == schema && regionPhase == phase) {
+		return true;
+	}
+	// Different records can still have the same byte order (ie: all ints), the pattern repeats every size * size bytes
+	uint64_t length = end - start;
+	uint64_t period = (uint64_t)region->schema->size * schema->size;
+	if (length > period) length = period;
+	for (uint32_t i = 0; i < length; ++i) {
+		if (schemaByteKind(region->schema, (regionPhase + i) % region->schema->size) != schemaByteKind(schema, (phase + i) % schema->size)) {
+			return false;
+		}
+	}
+	return true;
+}
 
-		writeNormalInt = &writeBigInt;
-		writeNormalShort = &writeBigShort;
+// visitRegion results
+// Not converted yet (or not the same way)
+#define REGION_NEW 0
+// Already converted with the same byte order, converting again can be skipped
+#define REGION_SAME_BYTES 1
+// Already converted as the same records, so anything they point to was converted too
+#define REGION_SAME_RECORDS 2
+
+// Records that [start, end) is about to be converted as records of schema
+// Overlaps with a different layout are kept as conflicts and the new layout takes over those bytes
+static int claimRegion(StageCursor *stage, uint32_t start, uint32_t end, const RecordSchema *schema) {
+	if (stage->visited == NULL || start >= end) return REGION_NEW;
+
+	VisitedMap *visited = stage->visited;
+	std::lock_guard<std::mutex> guard(visited->lock);
+	std::map<uint32_t, VisitedRegion> &regions = visited->regions;
+
+	// First region that could overlap
+	std::map<uint32_t, VisitedRegion>::iterator first = regions.upper_bound(start);
+	if (first != regions.begin()) {
+		std::map<uint32_t, VisitedRegion>::iterator previous = first;
+		--previous;
+		if (previous->second.end > start) {
+			first = previous;
+		}
+	}
 
+	uint32_t coveredTo = start;
+	bool covered = true;
+	bool sameRecords = true;
+	std::vector<uint32_t> overlapping;
+	for (std::map<uint32_t, VisitedRegion>::iterator i = first; i != regions.end() && i->first < end; ++i) {
+		uint32_t overlapStart = i->first > start ? i->first : start;
+		uint32_t overlapEnd = i->second.end < end ? i->second.end : end;
+		overlapping.push_back(i->first);
+
+		if (overlapStart != coveredTo) {
+			covered = false;
+		}
+		if (sameLayout(&i->second, schema, start, overlapStart, overlapEnd)) {
+			coveredTo = overlapEnd;
+			if (i->second.schema != schema || (overlapStart - i->second.origin) % schema->size != (overlapStart - start) % schema->size) {
+				sameRecords = false;
+			}
+		}
+		else {
+			covered = false;
+			StageConflict conflict = { overlapStart, overlapEnd, i->second.schema, schema };
+			visited->conflicts.push_back(conflict);
+		}
+	}
+	if (covered && coveredTo == end) {
+		return sameRecords ? REGION_SAME_RECORDS : REGION_SAME_BYTES;
 	}
 
-	FILE *converted = fopen(outfilename.c_str(), "wb");
+	// Cut the new region out of the ones it overlaps
+	for (size_t i = 0; i < overlapping.size(); ++i) {
+		uint32_t regionStart = overlapping[i];
+		VisitedRegion region = regions[regionStart];
+		regions.erase(regionStart);
+		if (regionStart < start) {
+			VisitedRegion before = region;
+			before.end = start;
+			regions[regionStart] = before;
+		}
+		if (region.end > end) {
+			regions[end] = region;
+		}
+	}
+	VisitedRegion region = { end, start, schema };
+	regions[start] = region;
+	return REGION_NEW;
+}
 
-	if (converted == NULL) {
-		fclose(original);
-		printf("Failed to open file: %s\n", strerror(errno));
-		return;
+// Adds the region to the graph along with every pointer read so far that points to it
+static void addGraphNode(GraphBuilder *graph, uint32_t start, uint32_t end, const RecordSchema *schema) {
+	std::pair<uint32_t, const RecordSchema*> key(start, schema);
+	std::map<std::pair<uint32_t, const RecordSchema*>, uint32_t>::iterator found = graph->nodeIndex.find(key);
+	uint32_t node;
+	if (found == graph->nodeIndex.end()) {
+		node = (uint32_t)graph->nodes.size();
+		graph->nodeIndex[key] = node;
+		StageNode stageNode = { start, end, schema, 0, 0 };
+		graph->nodes.push_back(stageNode);
+	}
+	else {
+		node = found->second;
+		if (end > graph->nodes[node].end) {
+			graph->nodes[node].end = end;
+		}
 	}
 
-	fseek(original, 0, SEEK_SET);
+	std::pair<std::multimap<uint32_t, uint32_t>::iterator, std::multimap<uint32_t, uint32_t>::iterator> pointers = graph->pointers.equal_range(start);
+	for (std::multimap<uint32_t, uint32_t>::iterator i = pointers.first; i != pointers.second; ++i) {
+		StageEdge edge = { i->second, 0, node };
+		graph->edges.push_back(edge);
+	}
+	graph->pointers.erase(pointers.first, pointers.second);
+}
 
-	// Actually begin parsing/converting
+// Points every pointer to the list node at listStart to the node of a record later in the list too
+// (a list converted in two parts, ie: the wormhole left after the pairs, is still one list to whatever points to it)
+static void addGraphListPart(StageCursor *stage, uint32_t listStart, const RecordSchema *listSchema, uint32_t partStart, const RecordSchema *partSchema) {
+	if (stage->graph == NULL) return;
+	GraphBuilder *graph = stage->graph;
+	std::map<std::pair<uint32_t, const RecordSchema*>, uint32_t>::iterator list = graph->nodeIndex.find(std::make_pair(listStart, listSchema));
+	std::map<std::pair<uint32_t, const RecordSchema*>, uint32_t>::iterator part = graph->nodeIndex.find(std::make_pair(partStart, partSchema));
+	if (list == graph->nodeIndex.end() || part == graph->nodeIndex.end()) return;
+
+	size_t edgeCount = graph->edges.size();
+	for (size_t i = 0; i < edgeCount; ++i) {
+		if (graph->edges[i].to == list->second) {
+			StageEdge edge = { graph->edges[i].field, 0, part->second };
+			graph->edges.push_back(edge);
+		}
+	}
+}
 
-	// Declare variables here for so they are seen when relavant
+// Remembers an offset read from the field at field, it becomes an edge if a region is visited there
+static inline void addGraphPointer(StageCursor *stage, uint32_t field, uint32_t value) {
+	if (stage->graph == NULL || value == 0 || value >= stage->size) return;
+	stage->graph->pointers.insert(std::make_pair(value, field));
+}
 
-	Item collisionFields;
-	Item startPositions;
-	Item falloutY;
-	Item goals;
-	Item bumpers;
-	Item jamabars;
-	Item bananas;
-	Item coneCollisions;
-	Item cylinderCollisions;
-	Item sphereCollisions;
-	Item falloutVolumes;
-	Item backgroundModels;
-	Item mysteryEight;
-	Item mysteryTwelve;
-	Item mysteryFourteen;
-	Item mysteryFifteen;
-	Item reflectiveModels;
-	Item modelDuplicates;
-	Item levelModelA;
-	Item levelModelB;
-	Item switches;
-	Item fogAnimation;
-	Item wormholes;
-	Item fog;
-	Item mysteryThree;
+// claimRegion, also adding the region to the stage being read
+// Records already read as another schema with the same byte order (ie: goals and start positions) are added again as this one
+static int visitRegion(StageCursor *stage, uint32_t start, uint32_t end, const RecordSchema *schema) {
+	// Everything converted as a region is read (and converted) right after this
+	waitForStage(stage, end);
+	if (stage->graph != NULL) {
+		addGraphNode(stage->graph, start, end, schema);
+	}
+	markWritten(stage, start, end - start);
+	int visit = claimRegion(stage, start, end, schema);
+	if (visit != REGION_SAME_RECORDS && stage->model != NULL && start < end) {
+		addStageRecords(stage->model, schema, stage->original, start, end - start);
+	}
+	return visit;
+}
 
-#pragma region File_Header
+// Whether everything a record points to can be skipped when the record itself was already converted
+// Only on one thread (field tasks have to log everything they would write) and only while nothing overlapped,
+// an overlap may have changed bytes the earlier conversion wrote
+static inline bool skipVisitedChildren(StageCursor *stage) {
+	if (stage->visited == NULL || stage->written != NULL) return false;
+	std::lock_guard<std::mutex> guard(stage->visited->lock);
+	return stage->visited->conflicts.empty();
+}
 
+// Converts the int at the current position and returns its value
+// Anything past the end of the file reads as all 1s (like EOF) and isn't written
+template <typename Format>
+static inline uint32_t convertInt(StageCursor *stage) {
+	uint32_t position = stage->position;
+	stage->position += 4;
+	if (!inStage(stage, position, 4)) {
+		return 0xFFFFFFFF;
+	}
+	waitForStage(stage, position + 4);
+	// Converting is always a byte swap, only reading the value depends on the game
+	const uint8_t *in = &stage->original[position];
+	storeInt(&stage->converted[position], swapInt(loadInt(in)));
+	markWritten(stage, position, 4);
+	return Format::readInt(in);
+}
 
-	// Header (0x0, length = 0x8)
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
+template <typename Format>
+static inline uint16_t convertShort(StageCursor *stage) {
+	uint32_t position = stage->position;
+	stage->position += 2;
+	if (!inStage(stage, position, 2)) {
+		return 0xFFFF;
+	}
+	waitForStage(stage, position + 2);
+	const uint8_t *in = &stage->original[position];
+	storeShort(&stage->converted[position], swapShort(loadShort(in)));
+	markWritten(stage, position, 2);
+	return Format::readShort(in);
+}
 
-	// Collision Header (0x8, length = 0x8)
-	collisionFields = readItem(original, converted);
-	
-	// Start positions (0x10, length = 0x4)
-	startPositions.offset = readInt(original);
-	writeInt(converted, startPositions.offset);
+// Runtime layout of a schema (size 0 if the record is too big to shuffle, it's then converted field by field)
+static RecordLayout schemaLayout(const RecordSchema &schema) {
+	RecordLayout layout;
+	if (!buildSchemaLayout(&layout, &schema)) {
+		layout.size = 0;
+	}
+	return layout;
+}
 
-	// Fallout Y (0x14, length = 0x4)
-	falloutY.offset = readInt(original);
-	writeInt(converted, falloutY.offset);
+// Converts count back to back records described by schema starting at offset
+// Records running past the end of the file only have the fields inside the file converted
+// Returns false if there was nothing to convert or the same records were already converted
+template <const RecordSchema &schema>
+static bool convertRecords(StageCursor *stage, uint32_t offset, int count) {
+	static const RecordLayout layout = schemaLayout(schema);
 
-	// The number of start positions is the fallout Y offset - startPosition offset / sizeof(startPosition)
-	startPositions.number = (falloutY.offset - 0x89C) / 0x14;
+	if (count <= 0 || offset >= stage->size) return false;
 
-	// Goals (0x18, length = 0x8)
-	goals = readItem(original, converted);
+	uint32_t available = (stage->size - offset) / schema.size;
+	uint32_t whole = (uint32_t)count < available ? (uint32_t)count : available;
+	uint32_t end = whole < (uint32_t)count ? stage->size : offset + whole * schema.size;
+	int visit = visitRegion(stage, offset, end, &schema);
+	if (visit != REGION_NEW) return visit != REGION_SAME_RECORDS;
+	if (stage->converted == NULL) return true;
 
-	// Bumpers (0x20, length = 0x8)
-	bumpers = readItem(original, converted);
+	const uint8_t *in = &stage->original[offset];
+	uint8_t *out = &stage->converted[offset];
 
-	// Jamabars (0x28, length = 0x8)
-	jamabars = readItem(original, converted);
+	if (layout.size != 0) {
+		swapRecords(&layout, in, out, whole);
+	}
+	else {
+		for (uint32_t i = 0; i < whole; i++) {
+			swapRecordFields(&schema, &in[i * schema.size], &out[i * schema.size], schema.size);
+		}
+	}
 
-	// Bananas (0x30, length = 0x8)
-	bananas = readItem(original, converted);
+	if (whole < (uint32_t)count) {
+		uint32_t start = whole * schema.size;
+		swapRecordFields(&schema, &in[start], &out[start], stage->size - offset - start);
+	}
+	return true;
+}
 
-	// Cone Collisions (0x38, length = 0x8)
-	coneCollisions = readItem(original, converted);
+// Converts a list of records (nothing if the offset is null)
+template <const RecordSchema &schema>
+static inline void copyList(StageCursor *stage, Item item) {
+	if (item.offset == 0) return;
+	convertRecords<schema>(stage, item.offset, item.number);
+}
 
-	// Sphere Collisions (0x40, length = 0x8)
-	sphereCollisions = readItem(original, converted);
+// Converts a single record (nothing if the offset is null)
+template <const RecordSchema &schema>
+static inline void copyRecord(StageCursor *stage, uint32_t offset) {
+	if (offset == 0) return;
+	convertRecords<schema>(stage, offset, 1);
+}
 
-	// Cylinder Collisions (0x48, length = 0x8)
-	cylinderCollisions = readItem(original, converted);
+// Offset of record index in a list
+// Returns false once the record starts past the end of the file (there is nothing left to convert)
+static inline bool recordOffset(StageCursor *stage, uint32_t offset, int index, uint32_t size, uint32_t *record) {
+	uint64_t position = (uint64_t)offset + (uint64_t)index * size;
+	if (position >= stage->size) return false;
+	*record = (uint32_t)position;
+	return true;
+}
 
-	// Fallout Volumes (0x50, length = 0x8)
-	falloutVolumes = readItem(original, converted);
+// Reads a field of the record at offset
+// Anything past the end of the file reads as all 1s (like convertInt)
+template <typename Format>
+static inline uint32_t readStageInt(StageCursor *stage, uint32_t offset, uint32_t fieldOffset) {
+	uint64_t position = (uint64_t)offset + fieldOffset;
+	if (position + 4 > stage->size) {
+		return 0xFFFFFFFF;
+	}
+	waitForStage(stage, (uint32_t)position + 4);
+	uint32_t value = Format::readInt(&stage->original[position]);
+	markRead(stage, (uint32_t)position, 4);
+	addGraphPointer(stage, (uint32_t)position, value);
+	return value;
+}
 
-	// Background Models (0x58, length = 0x8)
-	backgroundModels = readItem(original, converted);
+template <typename Format>
+static inline Item readStageItem(StageCursor *stage, uint32_t offset, uint32_t fieldOffset) {
+	Item item;
+	item.number = readStageInt<Format>(stage, offset, fieldOffset);
+	item.offset = readStageInt<Format>(stage, offset, fieldOffset + 4);
+	return item;
+}
 
-	// Mystery Eight (0x60, length = 0x8)
-	mysteryEight = readItem(original, converted);
+// Same as convertRecords<collisionTriangleSchema> with the dedicated triangle kernel
+static void convertCollisionTriangles(StageCursor *stage, uint32_t offset, uint32_t count) {
+	if (count == 0 || offset >= stage->size) return;
 
-	// Mystery Twelve (0x68, length = 0x4)
-	mysteryTwelve.offset = readInt(original);
-	writeInt(converted, mysteryTwelve.offset);
+	uint32_t available = (stage->size - offset) / COLLISION_TRIANGLE_SIZE;
+	uint32_t whole = count < available ? count : available;
+	uint32_t end = whole < count ? stage->size : offset + whole * COLLISION_TRIANGLE_SIZE;
+	if (visitRegion(stage, offset, end, &collisionTriangleSchema) != REGION_NEW || stage->converted == NULL) return;
 
-	// One, but not always one (0x6C, length = 0x4)
-	writeInt(converted, readInt(original));
+	swapCollisionTriangles(&stage->original[offset], &stage->converted[offset], whole);
 
-	// Reflective Models (0x70, length = 0x8)
-	reflectiveModels = readItem(original, converted);
+	if (whole < count) {
+		uint32_t start = offset + whole * COLLISION_TRIANGLE_SIZE;
+		swapRecordFields(&collisionTriangleSchema, &stage->original[start], &stage->converted[start], stage->size - start);
+	}
+}
 
-	// Mystery Fourteen (0x78, length = 0x4)
-	mysteryFourteen.offset = readInt(original);
-	writeInt(converted, mysteryFourteen.offset);
+static void copyAsciiAligned(StageCursor *stage, uint32_t offset) {
+	if (offset == 0 || offset >= stage->size) return;
 
-	// Unknown/Null (0x7C, length = 0x8)
-	for (int i = 0; i < 0x8; i += 4) {
-		writeInt(converted, readInt(original));
+	// Copy characters until at the end of file
+	// or at the end of the ascii and 4 byte aligned
+	uint32_t end = offset;
+	while (end < stage->size) {
+		waitForStage(stage, end + 1);
+		uint8_t c = stage->original[end++];
+		if (c == 0 && end % 4 == 0) {
+			break;
+		}
 	}
-	
-	// Model Duplicates (0x84, length = 0x8)
-	modelDuplicates = readItem(original, converted);
+	markRead(stage, offset, end - offset);
+	if (visitRegion(stage, offset, end, &asciiSchema) != REGION_NEW || stage->converted == NULL) return;
+	memcpy(&stage->converted[offset], &stage->original[offset], end - offset);
+}
 
-	// Level Model A (0x8C, length = 0x8)
-	levelModelA = readItem(original, converted);
+template <typename Format>
+static void copyKeyframes(StageCursor *stage, uint32_t offset, uint32_t keysOffset, int numKeys);
+template <typename Format>
+static void copyCollisionAnimation(StageCursor *stage, uint32_t offset);
+template <typename Format, const RecordSchema &schema>
+static void copyBackgroundAnimation(StageCursor *stage, uint32_t offset, int numKeys);
+template <typename Format>
+static void copyFogAnimation(StageCursor *stage, uint32_t offset);
 
-	// Level Model B (0x94, length = 0x8)
-	levelModelB = readItem(original, converted);
+template <typename Format>
+static void copyEffects(StageCursor *stage, uint32_t offset);
 
-	// Mystery Fifteen (0x9C, length = 0x8)
-	mysteryFifteen = readItem(original, converted);
+template <typename Format>
+static uint32_t copyCollisionTriangleGrid(StageCursor *stage, uint32_t offset, uint32_t xStepCount, uint32_t zStepCount);
 
-	// Unknown/Null (0xA4, length = 0x4)
-	for (int i = 0; i < 0x4; i += 4) {
-		writeInt(converted, readInt(original));
-	}
-	
-	// Switches (0xA8, length = 0x8)
-	switches = readItem(original, converted);
+static void copyWormholes(StageCursor *stage, Item item);
+template <typename Format>
+static void copyBackgroundModels(StageCursor *stage, Item item);
+template <typename Format>
+static void copyMysteryEights(StageCursor *stage, Item item);
+template <typename Format>
+static void copyMysteryTwelves(StageCursor *stage, uint32_t offset);
+template <typename Format>
+static void copyMysteryFifteens(StageCursor *stage, Item item);
+template <typename Format>
+static void copyReflectiveModels(StageCursor *stage, Item item);
+template <typename Format>
+static void copyLevelModelAs(StageCursor *stage, Item item);
+template <typename Format>
+static void copyCollisionField(StageCursor *stage, uint32_t field);
+template <typename Format>
+static void copyCollisionFields(StageCursor *stage, Item item);
 
-	// Fog Animation (0xB0, length = 0x4)
-	fogAnimation.offset = readInt(original);
-	writeInt(converted, fogAnimation.offset);
+template <typename Format>
+static void convertStage(StageCursor *stage);
 
-	// Wormholes (0xB4, length = 0x8)
-	wormholes = readItem(original, converted);
+// decoding is set when input is still being decompressed, everything waits for the bytes it reads
+static int convertStageImage(const uint8_t* input, uint32_t size, uint8_t* output, int game, WorkPool *pool, std::vector<StageConflict> *conflicts, DecodeWatermark *decoding);
 
-	// Fog (0xBC, length = 0x4)
-	fog.offset = readInt(original);
-	writeInt(converted, fog.offset);
+static int convertStageInPlace(uint8_t* data, uint32_t size, int game, WorkPool *pool, std::vector<StageConflict> *conflicts);
 
-	// Unknown/Null (0xC0, length = 0x14)
-	for (int i = 0; i < 0x14; i += 4) {
-		writeInt(converted, readInt(original));
-	}
+static void planStage(const uint8_t *input, uint32_t size, int game, VisitedMap *visited, std::vector<StageRegion> *reads);
 
-	// Mystery Three (0xD4, length = 0x4)
-	mysteryThree.offset = readInt(original);
-	writeInt(converted, mysteryThree.offset);
+static int convertWithPlanCache(StagePlanCache *cache, const uint8_t* input, uint32_t size, uint8_t* output, int game, WorkPool *pool, std::vector<StageConflict> *conflicts);
 
-	// Unknown/Null (0xD8, length = 0x7C4)
-	for (int i = 0; i < 0x7C4; i += 4) {
-		writeInt(converted, readInt(original));
-	}
-	
-#pragma endregion File_Header
+static void mergeRegions(std::vector<StageRegion> *regions);
 
-	// Start copying the rest of the file
-	// Order shouldn't matter
-	// By having everything in separate methods,
-	// it avoids code duplication in the collision header
-	copyStartPositions(original, converted, startPositions);
+static bool writeStagePlan(const VisitedMap *visited, const uint8_t *input, uint32_t size, FILE *file);
 
-	copyFalloutY(original, converted, falloutY);
+static void reportConflicts(ConversionContext *context, std::vector<StageConflict> *conflicts);
 
-	copyGoals(original, converted, goals);
 
-	copyBumpers(original, converted, bumpers);
 
-	copyJamabars(original, converted, jamabars);
+void parseRawLZ(const char* filename) {
+	ConversionContext context;
+	initConversionContext(&context, filename);
 
-	copyBananas(original, converted, bananas);
+	if (loadInputFile(&context)) {
+		convertRawLZToFile(&context);
+	}
+	printDiagnostics(&context);
+}
 
-	copyConeCollisions(original, converted, coneCollisions);
+int convertRawLZ(ConversionContext *context) {
+	uint32_t size = (uint32_t)context->input.size;
+	bool inPlace = context->inPlace && context->input.writable != NULL;
+	if (!inPlace) {
+		context->output.resize(size);
+	}
 
-	copyCylinderCollisions(original, converted, cylinderCollisions);
+	int game = -1;
+	if (size >= 0x89C) {
+		if (context->sourceGame == GAME_UNKNOWN) {
+			context->sourceGame = context->input.data[4] == 0 ? SMBD : SMB2;
+		}
+		adviseInputSource(&context->input, INPUT_ACCESS_RANDOM);
+		std::vector<StageConflict> conflicts;
+		if (context->plans != NULL) {
+			uint8_t *output = inPlace ? context->input.writable : context->output.data();
+			game = convertWithPlanCache(context->plans, context->input.data, size, output, context->sourceGame, context->pool, &conflicts);
+		}
+		else if (inPlace) {
+			game = convertStageInPlace(context->input.writable, size, context->sourceGame, context->pool, &conflicts);
+		}
+		else {
+			game = convertStageImage(context->input.data, size, context->output.data(), context->sourceGame, context->pool, &conflicts, NULL);
+		}
+		reportConflicts(context, &conflicts);
+	}
 
-	copySphereCollisions(original, converted, sphereCollisions);
+	if (game == -1) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Error converting file: %s", context->filename.c_str());
+		return -1;
+	}
+	context->sourceGame = game;
+	context->targetGame = game == SMBD ? SMB2 : SMBD;
+	context->convertedInPlace = inPlace;
+	return 0;
+}
 
-	copyFalloutVolumes(original, converted, falloutVolumes);
-	
-	copySwitches(original, converted, switches);
+int convertRawLZToFile(ConversionContext *context) {
+	uint32_t size = (uint32_t)context->input.size;
+	if (size < 0x89C) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Error converting file: %s", context->filename.c_str());
+		return -1;
+	}
+	if (context->sourceGame == GAME_UNKNOWN) {
+		context->sourceGame = context->input.data[4] == 0 ? SMBD : SMB2;
+	}
+	context->targetGame = context->sourceGame == SMBD ? SMB2 : SMBD;
+
+	// Only pointers are read while planning, the records themselves are read once in file order
+	adviseInputSource(&context->input, INPUT_ACCESS_SPARSE);
+	VisitedMap visited;
+	planStage(context->input.data, size, context->sourceGame, &visited, NULL);
+	reportConflicts(context, &visited.conflicts);
+
+	std::string filename = convertedFilename(context);
+	if (!visited.conflicts.empty()) {
+		// Where two layouts overlap, bytes of one can still hold what the other wrote, only a normal conversion gets that right
+		context->output.resize(size);
+		convertStageImage(context->input.data, size, context->output.data(), context->sourceGame, context->pool, NULL, NULL);
+		return writeOutputFile(context, filename, context->output.data(), size) ? 0 : -1;
+	}
 
-	copyWormholes(original, converted, wormholes);
-	
-	copyFog(original, converted, fog);
-	
-	copyFogAnimation(original, converted, fogAnimation);
-	
-	copyMysteryThrees(original, converted, mysteryThree);
-	
-	copyLevelModelAs(original, converted, levelModelA);
-	
-	copyLevelModelBs(original, converted, levelModelB);
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Failed to open file: %s (%s)", filename.c_str(), strerror(errno));
+		return -1;
+	}
+	adviseInputSource(&context->input, INPUT_ACCESS_SEQUENTIAL);
+	bool written = writeStagePlan(&visited, context->input.data, size, file);
+	if (fclose(file) != 0 || !written) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Failed to write file: %s", filename.c_str());
+		return -1;
+	}
+	return 0;
+}
 
-	copyReflectiveModels(original, converted, reflectiveModels);
+// Bytes decoded between two updates of the watermark when converting while decompressing
+#define STAGE_DECODE_CHUNK 0x4000
+
+// Decompresses the lz in context->input on this thread while a task on context->pool converts it
+// The conversion starts as soon as the header is there and every read waits only for the bytes it needs
+// (collision fields convert as their own tasks, each waiting for its own data)
+static int convertDecodingLZ(ConversionContext *context, uint32_t dataSize) {
+	std::vector<uint8_t> raw(dataSize);
+	context->output.resize(dataSize);
+	DecodeWatermark decoding;
+	initDecodeWatermark(&decoding);
+
+	const uint8_t *input = raw.data();
+	uint8_t *output = context->output.data();
+	WorkPool *pool = context->pool;
+	int sourceGame = context->sourceGame;
+	int game = -1;
+	std::vector<StageConflict> conflicts;
+
+	WorkGroup group;
+	initWorkGroup(&group);
+	addGroupWork(pool, &group, [input, output, dataSize, pool, &sourceGame, &game, &conflicts, &decoding]() {
+		// The header says which game the stage is from
+		waitDecoded(&decoding, 0x89C);
+		if (sourceGame == GAME_UNKNOWN) {
+			sourceGame = input[4] == 0 ? SMBD : SMB2;
+		}
+		game = convertStageImage(input, dataSize, output, sourceGame, pool, &conflicts, &decoding);
+	});
+
+	adviseInputSource(&context->input, INPUT_ACCESS_SEQUENTIAL);
+	uint32_t position = 0;
+	int decoded = streamLZ(context->input.data, context->input.size, STAGE_DECODE_CHUNK, [&raw, &position, &decoding](const uint8_t* data, size_t size) {
+		memcpy(&raw[position], data, size);
+		position += (uint32_t)size;
+		publishDecoded(&decoding, position, false);
+		return true;
+	});
+	// Anything a short stream doesn't cover reads as zeros like decompressLZ leaves it
+	publishDecoded(&decoding, position, true);
+	waitWorkGroup(pool, &group);
+
+	if (decoded < 0) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Failed to decompress %s (%d)", context->filename.c_str(), decoded);
+		return -1;
+	}
+	setInputBuffer(&context->input, &raw);
+	reportConflicts(context, &conflicts);
+	if (game == -1) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Error converting file: %s", context->filename.c_str());
+		return -1;
+	}
+	context->sourceGame = game;
+	context->targetGame = game == SMBD ? SMB2 : SMBD;
+	context->convertedInPlace = false;
+	return 0;
+}
 
-	copyModelDuplicates(original, converted, modelDuplicates);
+int convertLZ(ConversionContext *context) {
+	uint32_t csize;
+	uint32_t dataSize;
+	if (readLZHeader(context->input.data, context->input.size, &csize, &dataSize) != 0) {
+		addDiagnostic(context, DIAGNOSTIC_ERROR, "Invalid lz header: %s", context->filename.c_str());
+		return -1;
+	}
 
-	copyBackgroundModels(original, converted, backgroundModels);
+	// Converting while decompressing needs another thread to convert on
+	// Batches already keep every thread busy (and match stages against the plan cache, which needs the whole stage)
+	if (context->pool != NULL && workPoolThreadCount(context->pool) > 1 && context->plans == NULL && !context->inPlace && dataSize >= 0x89C) {
+		if (convertDecodingLZ(context, dataSize) != 0) {
+			return -1;
+		}
+	}
+	else {
+		// Decompress
+		std::vector<uint8_t> raw(dataSize);
+		adviseInputSource(&context->input, INPUT_ACCESS_SEQUENTIAL);
+		int decoded = decompressLZ(context->input.data, context->input.size, raw.data(), dataSize);
+		if (decoded < 0) {
+			addDiagnostic(context, DIAGNOSTIC_ERROR, "Failed to decompress %s (%d)", context->filename.c_str(), decoded);
+			return -1;
+		}
 
-	copyMysteryEights(original, converted, mysteryEight);
+		// Convert the raw stage in place of the lz (unmapping the lz)
+		setInputBuffer(&context->input, &raw);
+		if (convertRawLZ(context) != 0) {
+			return -1;
+		}
+	}
 
-	copyMysteryTwelves(original, converted, mysteryTwelve);
+	// Recompress
+	if (context->recompress) {
+		std::vector<uint8_t> compressed(maxCompressedLZSize(dataSize));
+		int compressedSize = compressLZ(outputData(context), dataSize, compressed.data(), compressed.size(), context->compressionLevel);
+		if (compressedSize < 0) {
+			addDiagnostic(context, DIAGNOSTIC_ERROR, "Failed to compress %s (%d)", context->filename.c_str(), compressedSize);
+			return -1;
+		}
+		compressed.resize(compressedSize);
+		context->output.swap(compressed);
+		context->convertedInPlace = false;
+	}
+	return 0;
+}
 
-	copyMysteryFourteens(original, converted, mysteryFourteen);
+int convertRawLZ(const uint8_t* input, uint32_t size, uint8_t* output) {
+	// The stage header has to be there
+	if (size < 0x89C) {
+		return -1;
+	}
 
-	copyMysteryFifteens(original, converted, mysteryFifteen);
-	
-	copyCollisionFields(original, converted, collisionFields);
+	// Determine which game the raw lz is from and convert with its byte order
+	return convertRawLZ(input, size, output, input[4] == 0 ? SMBD : SMB2, NULL);
+}
 
-	fclose(original);
-	fclose(converted);
+int convertRawLZ(const uint8_t* input, uint32_t size, uint8_t* output, int game, WorkPool *pool) {
+	return convertStageImage(input, size, output, game, pool, NULL, NULL);
 }
 
-static void copyAnimation(FILE *input, FILE *output, uint32_t offset, int numKeys, int minLength) {
-	if (offset == 0) return;
-	uint32_t savePos = ftell(input);
+static int convertStageImage(const uint8_t* input, uint32_t size, uint8_t* output, int game, WorkPool *pool, std::vector<StageConflict> *conflicts, DecodeWatermark *decoding) {
+	// The stage header has to be there
+	if (size < 0x89C) {
+		return -1;
+	}
 
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
+	VisitedMap visited;
+	StageCursor cursor = { input, output, size, 0, pool, NULL, &visited, NULL, NULL, NULL, decoding, 0 };
 
-	Item *keyList = (Item *)malloc(sizeof(Item) * numKeys);
+	// Anything that isn't converted is left as zeros
+	memset(output, 0, size);
 
-	// Gather keys (0x0, length = 0x8 * numKeys
-	for (int i = 0; i < numKeys; i++) {
-		keyList[i].number = readInt(input);
-		keyList[i].offset = readInt(input);
-		if (keyList[i].offset == 0x3D1C) {
-			//puts("Found it");
-		}
-		writeInt(output, keyList[i].number);
-		writeInt(output, keyList[i].offset);
+	if (game == SMBD) {
+		convertStage<SMBDFormat>(&cursor);
+	}
+	else {
+		convertStage<SMB2Format>(&cursor);
 	}
 
-	// Unknown/Null (0x8 * numKeys, length = minLength - (0x8 * numKeys)
-	if (numKeys == 6 && minLength == 0x123456) {
-		// (Collision Header Animation Only)
-
-		// Three Floats? (0x30, length = 0xC)
-		writeInt(output, readInt(input));
-		writeInt(output, readInt(input));
-		writeInt(output, readInt(input));
+	if (conflicts != NULL) {
+		conflicts->swap(visited.conflicts);
+	}
+	return game == SMBD ? SMBD : SMB2;
+}
 
-		// Unknown/Null (0x3C, length = 0x2)
-		writeShort(output, readShort(input));
+int convertRawLZInPlace(uint8_t* data, uint32_t size, int game, WorkPool *pool) {
+	return convertStageInPlace(data, size, game, pool, NULL);
+}
 
-		// Some Short (0x3E, length = 0x2)
-		writeShort(output, readShort(input));
+// Walks the stage without writing anything
+// While there are no conflicts, visited then says how every byte is converted
+// Every byte read along the way is added to reads unless it's NULL
+static void planStage(const uint8_t *input, uint32_t size, int game, VisitedMap *visited, std::vector<StageRegion> *reads) {
+	StageCursor cursor = { input, NULL, size, 0, NULL, NULL, visited, NULL, NULL, reads, NULL, 0 };
+	if (game == SMBD) {
+		convertStage<SMBDFormat>(&cursor);
 	}
 	else {
-		for (int i = numKeys * 0x8; i < minLength; i += 4) {
-			writeInt(output, readInt(input));
-		}
+		convertStage<SMB2Format>(&cursor);
 	}
-	
-	for (int i = 0; i < numKeys; i++) {
-		if (keyList[i].number > 0 && keyList[i].offset != 0) {
-			
-			fseek(input, keyList[i].offset, SEEK_SET);
-			fseek(output, keyList[i].offset, SEEK_SET);
-
-			for (int j = 0; j < keyList[i].number; j++) {
-				// Easing (0x0, length = 0x4)
-				writeInt(output, readInt(input));
-
-				// Time (0x4, length = 0x4)
-				writeInt(output, readInt(input));
+}
 
-				// Value (0x8, length = 0x4)
-				writeInt(output, readInt(input));
+// Converts bytes [from, to) of the record starting at record into output (which starts at from)
+// Fields only partly inside (split between chunks) are converted a byte at a time with the rest of the field read from input,
+// fields cut off by the end of the file are zeroed (like converting field by field)
+// Only exact while nothing was converted two ways
+static void convertRecordPart(const RecordSchema *schema, const uint8_t *input, uint8_t *output, uint32_t size, uint32_t record, uint32_t from, uint32_t to) {
+	for (uint32_t i = 0; i < schema->fieldCount; ++i) {
+		const FieldSchema *field = &schema->fields[i];
+		for (uint32_t j = 0; j < field->count; ++j) {
+			uint32_t element = record + field->offset + j * field->width;
+			uint32_t elementEnd = element + field->width;
+			if (elementEnd <= from || element >= to) continue;
+
+			if (element >= from && elementEnd <= to) {
+				if (field->swap && field->width == 4) {
+					storeInt(&output[element - from], swapInt(loadInt(&input[element])));
+				}
+				else if (field->swap && field->width == 2) {
+					storeShort(&output[element - from], swapShort(loadShort(&input[element])));
+				}
+				else if (&input[element] != &output[element - from]) {
+					memcpy(&output[element - from], &input[element], field->width);
+				}
+				continue;
+			}
 
-				// Unknown/Null (0xC, length = 0x8)
-				for (int k = 0; k < 0x8; k += 4) {
-					writeInt(output, readInt(input));
+			uint32_t start = element > from ? element : from;
+			uint32_t end = elementEnd < to ? elementEnd : to;
+			for (uint32_t k = start; k < end; ++k) {
+				if (elementEnd > size) {
+					output[k - from] = 0;
+				}
+				else {
+					output[k - from] = input[field->swap ? element + elementEnd - 1 - k : k];
 				}
 			}
 		}
 	}
-	
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
-	free(keyList);
 }
 
-static void copyBackgroundAnimation(FILE *input, FILE *output, uint32_t offset, int numKeys, int minLength) {
-	if (offset == 0) return;
-	uint32_t savePos = ftell(input);
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
-
-	// Unknown/Null (0x0, length = 0x4)
-	writeInt(output, readInt(input));
-
-	// Animation Loop point (0x4, length = 0x4)
-	writeInt(output, readInt(input));
-
-	// Animation (0x8, length = 0x58)
-	copyAnimation(input, output, ftell(input), numKeys, minLength);
+// Converts bytes [from, to) of a visited region into output (which starts at from)
+static void convertRegionPart(const VisitedRegion *region, const uint8_t *input, uint8_t *output, uint32_t size, uint32_t from, uint32_t to) {
+	const RecordSchema *schema = region->schema;
+
+	// A record cut off by from (the start of the region or the part)
+	uint32_t phase = (from - region->origin) % schema->size;
+	if (phase != 0) {
+		uint32_t recordEnd = from - phase + schema->size;
+		uint32_t partEnd = recordEnd < to ? recordEnd : to;
+		convertRecordPart(schema, input, output, size, from - phase, from, partEnd);
+		output += partEnd - from;
+		from = partEnd;
+	}
+	if (from >= to) return;
 
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
+	uint32_t whole = (to - from) / schema->size * schema->size;
+	swapSchemaRecords(schema, &input[from], output, whole);
+	// A record cut off by to
+	if (from + whole < to) {
+		convertRecordPart(schema, input, &output[whole], size, from + whole, from + whole, to);
+	}
 }
 
-static void copyEffects(FILE *input, FILE *output, uint32_t offset) {
-	if (offset == 0) return;
-	uint32_t savePos = ftell(input);
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
-
-	// Effect 1 (0x0, length = 0x8)
-	Item effectOne = readItem(input, output);
-	
-	// Effect 2 (0x8, length = 0x8)
-	Item effectTwo = readItem(input, output);
+static int convertStageInPlace(uint8_t* data, uint32_t size, int game, WorkPool *pool, std::vector<StageConflict> *conflicts) {
+	// The stage header has to be there
+	if (size < 0x89C) {
+		return -1;
+	}
 
-	// Texture Scroll (0x10, length = 0x4)
-	uint32_t textureScrollOffset = readInt(input);
-	writeInt(output, textureScrollOffset);
+	// Every pointer is read before anything is swapped
+	VisitedMap visited;
+	planStage(data, size, game, &visited, NULL);
 
-	// Unknown/Null (0x14, length = 0x1C)
-	for (int i = 0; i < 0x1C; i += 4) {
-		writeInt(output, readInt(input));
+	if (!visited.conflicts.empty()) {
+		// Where two layouts overlap, bytes of one can still hold what the other wrote, so those are converted from a copy
+		std::vector<uint8_t> original(data, data + size);
+		convertStageImage(original.data(), size, data, game, pool, NULL, NULL);
+	}
+	else {
+		uint32_t position = 0;
+		for (std::map<uint32_t, VisitedRegion>::iterator i = visited.regions.begin(); i != visited.regions.end(); ++i) {
+			// Anything that isn't converted is left as zeros
+			memset(&data[position], 0, i->first - position);
+			convertRegionPart(&i->second, data, &data[i->first], size, i->first, i->second.end);
+			position = i->second.end;
+		}
+		memset(&data[position], 0, size - position);
 	}
 
-	// Copy Effects
-	copyEffectOne(input, output, effectOne);
+	if (conflicts != NULL) {
+		conflicts->swap(visited.conflicts);
+	}
+	return game == SMBD ? SMBD : SMB2;
+}
 
-	copyEffectTwo(input, output, effectTwo);
+// Bytes converted at a time when writing a planned stage
+#define STAGE_SWEEP_CHUNK 0x100000
 
-	copyTextureScroll(input, output, textureScrollOffset);
+// Converts input into file front to back as described by visited (from planStage)
+// Returns false if writing failed
+static bool writeStagePlan(const VisitedMap *visited, const uint8_t *input, uint32_t size, FILE *file) {
+	std::vector<uint8_t> chunk(size < STAGE_SWEEP_CHUNK ? size : STAGE_SWEEP_CHUNK);
+	std::map<uint32_t, VisitedRegion>::const_iterator first = visited->regions.begin();
 
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
-}
+	for (uint32_t chunkStart = 0; chunkStart < size; chunkStart += (uint32_t)chunk.size()) {
+		uint32_t chunkEnd = size - chunkStart < chunk.size() ? size : chunkStart + (uint32_t)chunk.size();
 
-static void copyEffectOne(FILE *input, FILE *output, Item item) {
-	uint32_t savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-	fseek(output, item.offset, SEEK_SET);
+		// Anything that isn't converted is left as zeros
+		memset(chunk.data(), 0, chunk.size());
+		while (first != visited->regions.end() && first->second.end <= chunkStart) {
+			++first;
+		}
+		for (std::map<uint32_t, VisitedRegion>::const_iterator i = first; i != visited->regions.end() && i->first < chunkEnd; ++i) {
+			uint32_t from = i->first > chunkStart ? i->first : chunkStart;
+			uint32_t to = i->second.end < chunkEnd ? i->second.end : chunkEnd;
+			convertRegionPart(&i->second, input, &chunk[from - chunkStart], size, from, to);
+		}
 
-	for (int i = 0; i < item.number; i++) {
-		// Unknown (0x0, length = 0xC)
-		writeInt(output, readInt(input)); // X?
-		writeInt(output, readInt(input)); // Y?
-		writeInt(output, readInt(input)); // Z?
+		if (fwrite(chunk.data(), 1, chunkEnd - chunkStart, file) != chunkEnd - chunkStart) {
+			return false;
+		}
+	}
+	return true;
+}
 
-		// Unknown (0xC, length = 0x8)
-		writeShort(output, readShort(input)); // X?
-		writeShort(output, readShort(input)); // Y?
-		writeShort(output, readShort(input)); // Z?
-		writeNormalShort(output, readShort(input)); // Marker?
+// Converts input into output (which can be input) with a plan recorded from a stage with the same structure
+static void replayStagePlan(const StagePlan *plan, const uint8_t *input, uint8_t *output) {
+	uint32_t position = 0;
+	for (size_t i = 0; i < plan->spans.size(); ++i) {
+		const StageSpan *span = &plan->spans[i];
+		VisitedRegion region = { span->end, span->origin, span->schema };
+
+		// Anything that isn't converted is left as zeros
+		memset(&output[position], 0, span->start - position);
+		convertRegionPart(&region, input, &output[span->start], plan->size, span->start, span->end);
+		position = span->end;
 	}
-	
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
+	memset(&output[position], 0, plan->size - position);
 }
-static void copyEffectTwo(FILE *input, FILE *output, Item item) {
-	uint32_t savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-	fseek(output, item.offset, SEEK_SET);
 
-	for (int i = 0; i < item.number; i++) {
-		// Unknown (0x0, length = 0xC)
-		writeInt(output, readInt(input)); // X?
-		writeInt(output, readInt(input)); // Y?
-		writeInt(output, readInt(input)); // Z?
+static int convertWithPlanCache(StagePlanCache *cache, const uint8_t* input, uint32_t size, uint8_t* output, int game, WorkPool *pool, std::vector<StageConflict> *conflicts) {
+	// The stage header has to be there
+	if (size < 0x89C) {
+		return -1;
+	}
+	game = game == SMBD ? SMBD : SMB2;
+
+	std::shared_ptr<const StagePlan> plan = findStagePlan(cache, input, size, game);
+	if (plan == NULL) {
+		VisitedMap visited;
+		std::vector<StageRegion> reads;
+		planStage(input, size, game, &visited, &reads);
+
+		// A plan only says how every byte is converted while nothing was converted two ways
+		if (!visited.conflicts.empty()) {
+			if (input == output) {
+				std::vector<uint8_t> original(input, input + size);
+				convertStageImage(original.data(), size, output, game, pool, NULL, NULL);
+			}
+			else {
+				convertStageImage(input, size, output, game, pool, NULL, NULL);
+			}
+			if (conflicts != NULL) {
+				conflicts->swap(visited.conflicts);
+			}
+			return game;
+		}
 
-		// Unknown/Null (0xC, length = 0x4)
-		// There is a discrepancy on the size of this (ie: is it 4 bytes or 1 byte then 3 bytes)
-		writeInt(output, readInt(input));
+		StagePlan *newPlan = new StagePlan();
+		newPlan->game = game;
+		newPlan->size = size;
+		for (std::map<uint32_t, VisitedRegion>::iterator i = visited.regions.begin(); i != visited.regions.end(); ++i) {
+			StageSpan span = { i->first, i->second.end, i->second.origin, i->second.schema };
+			newPlan->spans.push_back(span);
+		}
+		mergeRegions(&reads);
+		for (size_t i = 0; i < reads.size(); ++i) {
+			StageRead read = { reads[i].start, reads[i].end - reads[i].start };
+			newPlan->reads.push_back(read);
+			newPlan->readBytes.insert(newPlan->readBytes.end(), &input[reads[i].start], &input[reads[i].end]);
+		}
+		plan.reset(newPlan);
+		addStagePlan(cache, plan);
 	}
 
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
+	replayStagePlan(plan.get(), input, output);
+	return game;
 }
-static void copyTextureScroll(FILE *input, FILE *output, uint32_t offset) {
-	if (offset == 0) return;
 
-	uint32_t savePos = ftell(input);
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
+int parseStage(const uint8_t *input, uint32_t size, int game, Stage *stage) {
+	// The stage header has to be there
+	if (size < 0x89C) {
+		return -1;
+	}
+	if (game != SMB2 && game != SMBD) {
+		game = input[4] == 0 ? SMBD : SMB2;
+	}
+	initStage(stage, game, size);
 
-	// Speed (0x0, length = 0x8)
-	writeInt(output, readInt(input)); // X
-	writeInt(output, readInt(input)); // Y
-	
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
+	// Same walk as converting on one thread, only nothing is written
+	VisitedMap visited;
+	StageCursor cursor = { input, NULL, size, 0, NULL, NULL, &visited, stage, NULL, NULL, NULL, 0 };
+	if (game == SMBD) {
+		convertStage<SMBDFormat>(&cursor);
+	}
+	else {
+		convertStage<SMB2Format>(&cursor);
+	}
+	return game;
 }
 
-static uint32_t copyCollisionTriangleGrid(FILE *input, FILE *output, uint32_t offset, uint32_t xStepCount, uint32_t zStepCount) {
-	if (offset == 0) return 0;
-	uint32_t savePos = ftell(input);
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
+int buildStageGraph(const uint8_t *input, uint32_t size, int game, StageGraph *graph) {
+	// The stage header has to be there
+	if (size < 0x89C) {
+		return -1;
+	}
+	if (game != SMB2 && game != SMBD) {
+		game = input[4] == 0 ? SMBD : SMB2;
+	}
 
-	uint16_t maxIndex = 0;
-	int totalSteps = xStepCount * zStepCount;
-	for (int i = 0; i < totalSteps; i++) {
-		// Grid Pointer (0x0, length = 0x4)
-		uint32_t gridPointer = readInt(input);
-		writeInt(output, gridPointer);
-		if (gridPointer != 0) {
-			// Copy the actual grid...
-			uint32_t savePos2 = ftell(input);
-			fseek(input, gridPointer, SEEK_SET);
-			fseek(output, gridPointer, SEEK_SET);
-
-			do {
-				uint16_t index = readShort(input);
-				writeShort(output, index);
-				if (index == 0xFFFF) break;
-				if (index > maxIndex) maxIndex = index;
-			} while (1);
-
-			fseek(input, savePos2, SEEK_SET);
-			fseek(output, savePos2, SEEK_SET);
-		}
+	// Same walk as converting on one thread, only nothing is written
+	VisitedMap visited;
+	GraphBuilder builder;
+	StageCursor cursor = { input, NULL, size, 0, NULL, NULL, &visited, NULL, &builder, NULL, NULL, 0 };
+	if (game == SMBD) {
+		convertStage<SMBDFormat>(&cursor);
+	}
+	else {
+		convertStage<SMB2Format>(&cursor);
 	}
 
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
+	graph->game = game;
+	graph->size = size;
 
-	return (int)maxIndex;
+	// Number the nodes in file order
+	std::vector<uint32_t> order(builder.nodes.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = (uint32_t)i;
+	}
+	std::sort(order.begin(), order.end(), [&builder](uint32_t a, uint32_t b) {
+		const StageNode &nodeA = builder.nodes[a];
+		const StageNode &nodeB = builder.nodes[b];
+		if (nodeA.start != nodeB.start) return nodeA.start < nodeB.start;
+		if (nodeA.end != nodeB.end) return nodeA.end > nodeB.end;
+		return strcmp(nodeA.schema->name, nodeB.schema->name) < 0;
+	});
+	std::vector<uint32_t> renumbered(order.size());
+	graph->nodes.resize(order.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		renumbered[order[i]] = (uint32_t)i;
+		graph->nodes[i] = builder.nodes[order[i]];
+	}
+
+	// Each pointer belongs to the node its field is in
+	graph->edges.clear();
+	for (size_t i = 0; i < builder.edges.size(); ++i) {
+		StageEdge edge = builder.edges[i];
+		int from = findStageNode(graph, edge.field);
+		if (from < 0) continue;
+		edge.from = (uint32_t)from;
+		edge.to = renumbered[edge.to];
+		graph->edges.push_back(edge);
+	}
+	std::sort(graph->edges.begin(), graph->edges.end(), [](const StageEdge &a, const StageEdge &b) {
+		if (a.from != b.from) return a.from < b.from;
+		if (a.field != b.field) return a.field < b.field;
+		return a.to < b.to;
+	});
+	for (size_t i = 0; i < graph->edges.size(); ++i) {
+		StageNode *from = &graph->nodes[graph->edges[i].from];
+		if (from->edgeCount == 0) {
+			from->firstEdge = (uint32_t)i;
+		}
+		from->edgeCount++;
+	}
+	return game;
 }
 
-static void copyCollisionTriangles(FILE *input, FILE *output, uint32_t offset, uint32_t maxIndex) {
-	if (offset == 0) return;
-	uint32_t savePos = ftell(input);
-	fseek(input, offset, SEEK_SET);
-	fseek(output, offset, SEEK_SET);
-	// Collision Triangles are 0 indexed
-	// Because of that a max index of ie 10 must include 10 here
-	for (uint32_t i = 0; i <= maxIndex; i++) {
-		// Position 1 (0x0, length = 0xC)
-		writeInt(output, readInt(input)); // X
-		writeInt(output, readInt(input)); // Y
-		writeInt(output, readInt(input)); // Z
+static bool conflictBefore(const StageConflict &a, const StageConflict &b) {
+	if (a.start != b.start) return a.start < b.start;
+	if (a.end != b.end) return a.end < b.end;
+	if (a.first != b.first) return strcmp(a.first->name, b.first->name) < 0;
+	return strcmp(a.second->name, b.second->name) < 0;
+}
 
-		// Normal (0xC, length = 0xC)
-		writeInt(output, readInt(input)); // X
-		writeInt(output, readInt(input)); // Y
-		writeInt(output, readInt(input)); // Z
+static bool sameConflict(const StageConflict &a, const StageConflict &b) {
+	return a.start == b.start && a.end == b.end && a.first == b.first && a.second == b.second;
+}
 
-		// Roation From XY Plane (0x18, length = 0x8)
-		writeShort(output, readShort(input)); // X
-		writeShort(output, readShort(input)); // Y
-		writeShort(output, readShort(input)); // Z
-		writeShort(output, readShort(input)); // Padding
+static void reportConflicts(ConversionContext *context, std::vector<StageConflict> *conflicts) {
+	// Field tasks can find the same overlap in any order
+	for (size_t i = 0; i < conflicts->size(); ++i) {
+		StageConflict &conflict = (*conflicts)[i];
+		if (strcmp(conflict.first->name, conflict.second->name) > 0) {
+			std::swap(conflict.first, conflict.second);
+		}
+	}
+	std::sort(conflicts->begin(), conflicts->end(), conflictBefore);
+	conflicts->erase(std::unique(conflicts->begin(), conflicts->end(), sameConflict), conflicts->end());
+
+	const size_t maxReported = 20;
+	for (size_t i = 0; i < conflicts->size() && i < maxReported; ++i) {
+		const StageConflict &conflict = (*conflicts)[i];
+		addDiagnostic(context, DIAGNOSTIC_WARNING, "%s: %#x - %#x is converted as both %s and %s", context->filename.c_str(),
+			conflict.start, conflict.end, conflict.first->name, conflict.second->name);
+	}
+	if (conflicts->size() > maxReported) {
+		addDiagnostic(context, DIAGNOSTIC_WARNING, "%s: %d more overlapping regions", context->filename.c_str(), (int)(conflicts->size() - maxReported));
+	}
+}
 
-		// Distance (0x20, length = 0x10)
-		writeInt(output, readInt(input)); // DX2X1
-		writeInt(output, readInt(input)); // DY2Y1
-		writeInt(output, readInt(input)); // DX3X1
-		writeInt(output, readInt(input)); // DY3Y1
+template <typename Format>
+static void convertStage(StageCursor *stage) {
 
-		// Tangent (0x30, length = 0x8)
-		writeInt(output, readInt(input)); // X
-		writeInt(output, readInt(input)); // Y
+#pragma region File_Header
 
-		// Bitangent (0x38, length = 0x8)
-		writeInt(output, readInt(input)); // X
-		writeInt(output, readInt(input)); // Y
-	}
+	convertRecords<stageHeaderSchema>(stage, 0, 1);
 
-	fseek(input, savePos, SEEK_SET);
-	fseek(output, savePos, SEEK_SET);
-}
+	// Collision Header (0x8, length = 0x8)
+	Item collisionFields = readStageItem<Format>(stage, 0, 0x8);
 
-static Item readItem(FILE *input, FILE *output) {
-	Item newItem;
+	// Start positions (0x10, length = 0x4)
+	Item startPositions;
+	startPositions.offset = readStageInt<Format>(stage, 0, 0x10);
 
-	newItem.number = readInt(input);
-	newItem.offset = readInt(input);
-	writeInt(output, newItem.number);
-	writeInt(output, newItem.offset);
+	// Fallout Y (0x14, length = 0x4)
+	uint32_t falloutY = readStageInt<Format>(stage, 0, 0x14);
 
-	return newItem;
-}
+	// The number of start positions is the fallout Y offset - startPosition offset / sizeof(startPosition)
+	startPositions.number = ((int)falloutY - 0x89C) / (int)startPositionSchema.size;
+
+	Item goals = readStageItem<Format>(stage, 0, 0x18);
+	Item bumpers = readStageItem<Format>(stage, 0, 0x20);
+	Item jamabars = readStageItem<Format>(stage, 0, 0x28);
+	Item bananas = readStageItem<Format>(stage, 0, 0x30);
+	Item coneCollisions = readStageItem<Format>(stage, 0, 0x38);
+	Item sphereCollisions = readStageItem<Format>(stage, 0, 0x40);
+	Item cylinderCollisions = readStageItem<Format>(stage, 0, 0x48);
+	Item falloutVolumes = readStageItem<Format>(stage, 0, 0x50);
+	Item backgroundModels = readStageItem<Format>(stage, 0, 0x58);
+	Item mysteryEight = readStageItem<Format>(stage, 0, 0x60);
+	uint32_t mysteryTwelve = readStageInt<Format>(stage, 0, 0x68);
+	Item reflectiveModels = readStageItem<Format>(stage, 0, 0x70);
+	uint32_t mysteryFourteen = readStageInt<Format>(stage, 0, 0x78);
+	Item modelDuplicates = readStageItem<Format>(stage, 0, 0x84);
+	Item levelModelA = readStageItem<Format>(stage, 0, 0x8C);
+	Item levelModelB = readStageItem<Format>(stage, 0, 0x94);
+	Item mysteryFifteen = readStageItem<Format>(stage, 0, 0x9C);
+	Item switches = readStageItem<Format>(stage, 0, 0xA8);
+	uint32_t fogAnimation = readStageInt<Format>(stage, 0, 0xB0);
+	Item wormholes = readStageItem<Format>(stage, 0, 0xB4);
+	uint32_t fog = readStageInt<Format>(stage, 0, 0xBC);
+	uint32_t mysteryThree = readStageInt<Format>(stage, 0, 0xD4);
 
-static void copyStartPositions(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+#pragma endregion File_Header
 
-	// Loop through start positions
-	for (int i = 0; i < item.number; i++) {
-		// Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	// Start copying the rest of the file
+	// Order shouldn't matter
+	// By having everything in separate methods,
+	// it avoids code duplication in the collision header
+	copyList<startPositionSchema>(stage, startPositions);
 
-		// Rotation (0xC, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding/Null
-	}
-}
-static void copyFalloutY(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	copyRecord<falloutYSchema>(stage, falloutY);
 
-	// Fallout Y (0x0, length = 0x4)
-	writeInt(converted, readInt(original));
-}
-static void copyGoals(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	copyList<goalSchema>(stage, goals);
 
-	// Loop through goals
-	for (int i = 0; i < item.number; i++) {
-		// Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	copyList<bumperSchema>(stage, bumpers);
 
-												// Rotation (0xC, length = 0x6)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
+	copyList<jamabarSchema>(stage, jamabars);
 
-													// Goal Type (0x12, length = 2, marker)
-		writeNormalShort(converted, readShort(original)); // Goal Type
-	}
-}
-static void copyBumpers(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	copyList<bananaSchema>(stage, bananas);
 
-	// Loop through bumpers
-	for (int i = 0; i < item.number; i++) {
-		// Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	copyList<coneCollisionSchema>(stage, coneCollisions);
 
-		// Rotation (0xC, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding/Null
+	copyList<cylinderCollisionSchema>(stage, cylinderCollisions);
 
-		// Scale (0x14, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
-	}
-}
-static void copyJamabars(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	copyList<sphereCollisionSchema>(stage, sphereCollisions);
 
-	// Loop through jamabars
-	for (int i = 0; i < item.number; i++) {
-		// Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	copyList<falloutVolumeSchema>(stage, falloutVolumes);
+	
+	copyList<switchSchema>(stage, switches);
 
-		// Rotation (0xC, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding/Null
+	copyWormholes(stage, wormholes);
+	
+	copyRecord<fogSchema>(stage, fog);
+	
+	copyFogAnimation<Format>(stage, fogAnimation);
+	
+	copyRecord<mysteryThreeSchema>(stage, mysteryThree);
+	
+	copyLevelModelAs<Format>(stage, levelModelA);
+	
+	copyList<levelModelBSchema>(stage, levelModelB);
 
-		// Scale (0x14, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
-	}
-}
-static void copyBananas(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	copyReflectiveModels<Format>(stage, reflectiveModels);
 
-	// Loop through bananas
-	for (int i = 0; i < item.number; i++) {
-		// Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	copyList<modelDuplicateSchema>(stage, modelDuplicates);
 
-		// Banana Type (0xC, length = 4)
-		writeInt(converted, readInt(original));
-	}
-}
-static void copyConeCollisions(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	copyBackgroundModels<Format>(stage, backgroundModels);
 
-	// Loop through mystery sevens
-	for (int i = 0; i < item.number; i++) {
-		// Base Center Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	copyMysteryEights<Format>(stage, mysteryEight);
 
-		// Rotation (0xC, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding
+	copyMysteryTwelves<Format>(stage, mysteryTwelve);
 
-		// Radius One (0x14, length = 0x4)
-		writeInt(converted, readInt(original));
+	copyRecord<mysteryFourteenSchema>(stage, mysteryFourteen);
 
-		// Height (0x18, length = 0x4)
-		writeInt(converted, readInt(original));
+	copyMysteryFifteens<Format>(stage, mysteryFifteen);
+	
+	copyCollisionFields<Format>(stage, collisionFields);
+}
 
-		// Radius Two (0x1C, length = 0x4)
-		writeInt(converted, readInt(original));
+// Converts the keyframes of numKeys key lists (count, offset) at keysOffset in the animation at offset
+template <typename Format>
+static void copyKeyframes(StageCursor *stage, uint32_t offset, uint32_t keysOffset, int numKeys) {
+	for (int i = 0; i < numKeys; i++) {
+		Item keys = readStageItem<Format>(stage, offset, keysOffset + i * 0x8);
+		if (keys.number > 0 && keys.offset != 0) {
+			convertRecords<keyframeSchema>(stage, keys.offset, keys.number);
+		}
 	}
 }
-static void copyCylinderCollisions(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
 
-	// Loop through mystery sevens
-	for (int i = 0; i < item.number; i++) {
-		// Center Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
-
-		// Radius (0xC, length = 0x4)
-		writeInt(converted, readInt(original));
+template <typename Format>
+static void copyCollisionAnimation(StageCursor *stage, uint32_t offset) {
+	if (offset == 0) return;
+	if (!convertRecords<collisionAnimationSchema>(stage, offset, 1) && skipVisitedChildren(stage)) return;
+	copyKeyframes<Format>(stage, offset, 0x0, 6);
+}
 
-		// Height (0x10, length = 0x4)
-		writeInt(converted, readInt(original));
+template <typename Format, const RecordSchema &schema>
+static void copyBackgroundAnimation(StageCursor *stage, uint32_t offset, int numKeys) {
+	if (offset == 0) return;
+	if (!convertRecords<schema>(stage, offset, 1) && skipVisitedChildren(stage)) return;
+	copyKeyframes<Format>(stage, offset, 0x8, numKeys);
+}
 
-		// Rotation (0x14, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding
-	}
+template <typename Format>
+static void copyFogAnimation(StageCursor *stage, uint32_t offset) {
+	if (offset == 0) return;
+	if (!convertRecords<fogAnimationSchema>(stage, offset, 1) && skipVisitedChildren(stage)) return;
+	copyKeyframes<Format>(stage, offset, 0x0, 6);
 }
-static void copySphereCollisions(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
 
-	// Loop through sphere collisions
-	for (int i = 0; i < item.number; i++) {
-		// Center Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+template <typename Format>
+static void copyEffects(StageCursor *stage, uint32_t offset) {
+	if (offset == 0) return;
+	if (!convertRecords<effectsSchema>(stage, offset, 1) && skipVisitedChildren(stage)) return;
 
-		// Radius (0xC, length = 0x4)
-		writeInt(converted, readInt(original));
+	Item effectOne = readStageItem<Format>(stage, offset, 0x0);
+	Item effectTwo = readStageItem<Format>(stage, offset, 0x8);
+	uint32_t textureScrollOffset = readStageInt<Format>(stage, offset, 0x10);
 
-		// Short (0x10, length = 0x2)
-		writeShort(converted, readShort(original));
+	// The effect lists are converted even at a null offset
+	convertRecords<effectOneSchema>(stage, effectOne.offset, effectOne.number);
 
-		// Padding? (0x12, length = 0x2)
-		writeShort(converted, readShort(original));
-	}
-}
-static void copyFalloutVolumes(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-	//if (item.number == 0 && item.offset != 0) {
-	//	item.number = 1; // TODO 8 bytes if offset, no no count?
-	//}
-	// Loop through falloutVolumes
-	for (int i = 0; i < item.number; i++) {
-		// Center Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	convertRecords<effectTwoSchema>(stage, effectTwo.offset, effectTwo.number);
 
-		// Size (0x14, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	copyRecord<textureScrollSchema>(stage, textureScrollOffset);
+}
 
-		// Rotation (0xC, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding/Null
+// scanShortList over count shorts of the stage at offset
+// The end of a list isn't known up front, so while the stage is still being decompressed the list is scanned again as more of it comes in
+template <typename Format>
+static size_t scanStageShortList(StageCursor *stage, uint32_t offset, size_t count, uint16_t *maxValue) {
+	size_t ready = 0;
+	for (;;) {
+		if (stage->decoding == NULL) {
+			ready = count;
+		}
+		else {
+			uint64_t next = (uint64_t)offset + (ready + 1) * 2;
+			waitForStage(stage, next < stage->size ? (uint32_t)next : stage->size);
+			ready = stage->decoded > offset ? (stage->decoded - offset) / 2 : 0;
+			if (ready > count) ready = count;
+		}
+		size_t found = scanShortList(&stage->original[offset], ready, Format::game == SMB2, maxValue);
+		if (found < ready || ready == count) {
+			return found;
+		}
 	}
 }
-static void copyBackgroundModels(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
 
-	for (int i = 0; i < item.number; i++) {
-		// Background Model Symbol (0x0, length = 0x4)
-		writeInt(converted, readInt(original));
+template <typename Format>
+static uint32_t copyCollisionTriangleGrid(StageCursor *stage, uint32_t offset, uint32_t xStepCount, uint32_t zStepCount) {
+	if (offset == 0) return 0;
 
-		// Model Name Offset (0x4, length = 0x4)
-		uint32_t modelNameOffset = readInt(original);
-		writeInt(converted, modelNameOffset);
+	// Grid Pointers (length = 0x4 each, one per cell)
+	uint64_t totalSteps = (uint64_t)xStepCount * zStepCount;
+	if ((int)totalSteps <= 0 || offset >= stage->size) return 0;
+	uint32_t pointerCount = (uint32_t)totalSteps;
+	if (pointerCount > (stage->size - offset) / 4) {
+		pointerCount = (stage->size - offset) / 4;
+	}
 
-		// Null/Padding (0x8, length = 0x4)
-		writeInt(converted, readInt(original));
+	// Many cells share a triangle list, convert each one once (in file order)
+	std::vector<uint32_t> gridPointers;
+	gridPointers.reserve(pointerCount);
+	for (uint32_t i = 0; i < pointerCount; i++) {
+		uint32_t gridPointer = Format::readInt(&stage->original[offset + i * 4]);
+		markRead(stage, offset + i * 4, 4);
+		addGraphPointer(stage, offset + i * 4, gridPointer);
+		if (gridPointer != 0) {
+			gridPointers.push_back(gridPointer);
+		}
+	}
+	std::sort(gridPointers.begin(), gridPointers.end());
+	gridPointers.erase(std::unique(gridPointers.begin(), gridPointers.end()), gridPointers.end());
+
+	// Triangle indices (length = 0x2 each) up to and including the 0xFFFF at the end
+	std::vector<uint32_t> swapCounts(gridPointers.size(), 0);
+	uint16_t maxIndex = 0;
+	uint32_t pointersEnd = offset + pointerCount * 4;
+	// Where the lists so far end, by whether they start on an even or odd byte
+	uint32_t listsEnd[2] = { 0, 0 };
+	bool overlapping = false;
+	for (size_t i = 0; i < gridPointers.size(); i++) {
+		uint32_t gridPointer = gridPointers[i];
+		if (gridPointer >= stage->size) continue;
+
+		size_t available = (stage->size - gridPointer) / 2;
+		uint16_t listMax;
+		size_t indexCount = scanStageShortList<Format>(stage, gridPointer, available, &listMax);
+		if (listMax > maxIndex) maxIndex = listMax;
+
+		size_t swapCount = indexCount < available ? indexCount + 1 : available;
+		swapCounts[i] = (uint32_t)swapCount;
+		markRead(stage, gridPointer, (uint32_t)swapCount * 2);
+		uint32_t listEnd = gridPointer + (uint32_t)swapCount * 2;
+		// A list over the pointers, or over another list a byte off, comes out differently depending on which is converted last
+		if ((gridPointer < pointersEnd && listEnd > offset) || listsEnd[(gridPointer & 1) ^ 1] > gridPointer) {
+			overlapping = true;
+		}
+		if (listEnd > listsEnd[gridPointer & 1]) {
+			listsEnd[gridPointer & 1] = listEnd;
+		}
+	}
 
-		// Position (0xC, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+	if (overlapping) {
+		// Cell by cell (pointer then its list) like the original walk, so the same conversion wins
+		for (uint32_t i = 0; i < pointerCount; i++) {
+			if (visitRegion(stage, offset + i * 4, offset + i * 4 + 4, &gridPointerSchema) == REGION_NEW && stage->converted != NULL) {
+				swapInts(&stage->original[offset + i * 4], &stage->converted[offset + i * 4], 1);
+			}
+			uint32_t gridPointer = Format::readInt(&stage->original[offset + i * 4]);
+			if (gridPointer == 0 || gridPointer >= stage->size) continue;
+			size_t list = std::lower_bound(gridPointers.begin(), gridPointers.end(), gridPointer) - gridPointers.begin();
+			if (visitRegion(stage, gridPointer, gridPointer + swapCounts[list] * 2, &triangleIndexSchema) == REGION_NEW && stage->converted != NULL) {
+				swapShorts(&stage->original[gridPointer], &stage->converted[gridPointer], swapCounts[list]);
+			}
+		}
+	}
+	else {
+		if (visitRegion(stage, offset, offset + pointerCount * 4, &gridPointerSchema) == REGION_NEW && stage->converted != NULL) {
+			swapInts(&stage->original[offset], &stage->converted[offset], pointerCount);
+		}
+		for (size_t i = 0; i < gridPointers.size(); i++) {
+			if (swapCounts[i] == 0) continue;
+			uint32_t gridPointer = gridPointers[i];
+			if (visitRegion(stage, gridPointer, gridPointer + swapCounts[i] * 2, &triangleIndexSchema) == REGION_NEW && stage->converted != NULL) {
+				swapShorts(&stage->original[gridPointer], &stage->converted[gridPointer], swapCounts[i]);
+			}
+		}
+	}
 
-		// Rotation (0x18, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding
+	return (int)maxIndex;
+}
 
-		// Scale (0x20, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+static void copyWormholes(StageCursor *stage, Item item) {
+	if (item.offset == 0) return;
 
-		// Animation One (0x2C, length = 0x4)
-		uint32_t backgroundAnimationOffsetOne = readInt(original);
-		writeInt(converted, backgroundAnimationOffsetOne);
+	// Every second wormhole has its ID as a marker, so they are converted in pairs
+	convertRecords<wormholePairSchema>(stage, item.offset, item.number / 2);
 
-		// Animation Two (0x30, length = 0x4)
-		uint32_t backgroundAnimationOffsetTwo = readInt(original);
-		writeInt(converted, backgroundAnimationOffsetTwo);
+	uint32_t last;
+	if (item.number > 0 && item.number % 2 == 1 && recordOffset(stage, item.offset, item.number - 1, wormholeSchema.size, &last)) {
+		convertRecords<wormholeSchema>(stage, last, 1);
+		addGraphListPart(stage, item.offset, &wormholePairSchema, last, &wormholeSchema);
+	}
+}
 
-		// Effects (0x34, length = 0x4)
-		uint32_t effectsOffset = readInt(original);
-		writeInt(converted, effectsOffset);
+template <typename Format>
+static void copyBackgroundModels(StageCursor *stage, Item item) {
+	if (item.offset == 0) return;
+	if (!convertRecords<backgroundModelSchema>(stage, item.offset, item.number) && skipVisitedChildren(stage)) return;
 
+	uint32_t model;
+	for (int i = 0; i < item.number && recordOffset(stage, item.offset, i, backgroundModelSchema.size, &model); i++) {
 		// Copy model name
-		copyAsciiAligned(original, converted, modelNameOffset);
+		copyAsciiAligned(stage, readStageInt<Format>(stage, model, 0x4));
 		
 		// Copy animation one
-		copyBackgroundAnimation(original, converted, backgroundAnimationOffsetOne, 8, 0x0);
+		copyBackgroundAnimation<Format, backgroundAnimationOneSchema>(stage, readStageInt<Format>(stage, model, 0x2C), 8);
 
-		 // Copy animation two
-		copyBackgroundAnimation(original, converted, backgroundAnimationOffsetTwo, 11, 0x0);
+		// Copy animation two
+		copyBackgroundAnimation<Format, backgroundAnimationTwoSchema>(stage, readStageInt<Format>(stage, model, 0x30), 11);
 
 		// Copy effects
-		copyEffects(original, converted, effectsOffset);
+		copyEffects<Format>(stage, readStageInt<Format>(stage, model, 0x34));
 	}
 }
-static void copyMysteryEights(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
 
-	for (int i = 0; i < item.number; i++) {
-		// Marker (0x1F) (0x0, length = 0x4)
-		writeInt(converted, readInt(original));
+template <typename Format>
+static void copyMysteryEights(StageCursor *stage, Item item) {
+	if (item.offset == 0) return;
+	if (!convertRecords<mysteryEightSchema>(stage, item.offset, item.number) && skipVisitedChildren(stage)) return;
 
-		// Model Name Offset (0x4, length = 0x4)
-		uint32_t modelNameOffset = readInt(original);
-		writeInt(converted, modelNameOffset);
+	uint32_t mystery;
+	for (int i = 0; i < item.number && recordOffset(stage, item.offset, i, mysteryEightSchema.size, &mystery); i++) {
+		copyAsciiAligned(stage, readStageInt<Format>(stage, mystery, 0x4));
+	}
+}
 
-		// Unknown/Null (0x8, length = 0x4)
-		writeInt(converted, readInt(original));
+template <typename Format>
+static void copyMysteryTwelves(StageCursor *stage, uint32_t offset) {
+	if (offset == 0) return;
+	if (!convertRecords<mysteryTwelveSchema>(stage, offset, 1) && skipVisitedChildren(stage)) return;
 
-		// Position? (0xC, length = 0xC)
-		writeInt(converted, readInt(original)); // X?
-		writeInt(converted, readInt(original)); // Y?
-		writeInt(converted, readInt(original)); // Z?
+	Item setOne = readStageItem<Format>(stage, offset, 0x0);
+	Item setTwo = readStageItem<Format>(stage, offset, 0x8);
+	Item setThree = readStageItem<Format>(stage, offset, 0x10);
+	Item setFour = readStageItem<Format>(stage, offset, 0x18);
+	Item setFive = readStageItem<Format>(stage, offset, 0x20);
 
-		// Rotation? (0x18, length = 0x8)
-		writeShort(converted, readShort(original)); // X, generally null?
-		writeShort(converted, readShort(original)); // Y?
-		writeShort(converted, readShort(original)); // Z, generally null?
-		writeShort(converted, readShort(original)); // Padding, generally null?
+	// The sets are converted even at a null offset
+	convertRecords<mysteryTwelveEntrySchema>(stage, setOne.offset, setOne.number);
 
-		// Three floats (Generally the same value and small (ie .5)) (0x20, length = 0xC)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
+	convertRecords<mysteryTwelveEntrySchema>(stage, setTwo.offset, setTwo.number);
 
-		// Unknown/Null (0x2C, length = 0xC)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
+	convertRecords<mysteryTwelveEntrySchema>(stage, setThree.offset, setThree.number);
 
+	convertRecords<mysteryTwelveSetFiveSchema>(stage, setFive.offset, setFive.number);
 
-		copyAsciiAligned(original, converted, modelNameOffset);
-	}
-}
-static void copyMysteryTwelves(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-	
-	// 5 somthing sets? (0x0, length = 0x28)
-	Item setOne = readItem(original, converted); // Set 1
-	Item setTwo = readItem(original, converted); // Set 2
-	Item setThree = readItem(original, converted); // Set 3
-	Item setFour = readItem(original, converted); // Set 4
-	Item setFive = readItem(original, converted); // Set 5
-
-	// Unknown/Null (0x28, length = 0xC8)
-	for (int i = 0; i < 0xC8; i += 4) {
-		writeInt(converted, readInt(original));
-	}
-
-	// Copy Set 1 Data
-	fseek(original, setOne.offset, SEEK_SET);
-	fseek(converted, setOne.offset, SEEK_SET);
-	for (int i = 0; i < setOne.number; i++) {
-		// One (0x0, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Four Floats (0x4, length = 10)
-		writeInt(converted, readInt(original)); // X Rotation?
-		writeInt(converted, readInt(original)); // Y Rotation
-		writeInt(converted, readInt(original)); // Z Rotation?
-		writeInt(converted, readInt(original));
-	}
-
-	// Copy Set 2 Data
-	fseek(original, setTwo.offset, SEEK_SET);
-	fseek(converted, setTwo.offset, SEEK_SET);
-	for (int i = 0; i < setTwo.number; i++) {
-		// One (0x0, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Float (0x4, length = 0x4)
-		writeInt(converted, readInt(original)); // Incrementing Index (float for some reason, but use a whole number float)
-
-		// Unknown/Null (0x8, length = 0xC)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-	}
-
-	// Copy Set 3 Data
-	fseek(original, setThree.offset, SEEK_SET);
-	fseek(converted, setThree.offset, SEEK_SET);
-	for (int i = 0; i < setThree.number; i++) {
-		// One (0x0, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Incrementing Index (float value) (0x4, length = 4)
-		writeInt(converted, readInt(original)); // Incrementing Index (float for some reason, but use a whole number float)
-
-		// Unknown Float? (0x8, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Both of these floats are equal? (0xC, length = 0x8)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-	}
-
-	// Copy Set 5 Data
-	fseek(original, setFive.offset, SEEK_SET);
-	fseek(converted, setFive.offset, SEEK_SET);
-	for (int i = 0; i < setFive.number; i++) {
-		// Three Floats (0x0, length = 0xC)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		
-		// Four Shorts? (0xC, length = 0x8)
-		writeShort(converted, readShort(original));
-		writeShort(converted, readShort(original));
-		writeShort(converted, readShort(original));
-		writeShort(converted, readShort(original));
-	}
-
-	// Copy Set 4 Data
-	fseek(original, setFour.offset, SEEK_SET);
-	fseek(converted, setFour.offset, SEEK_SET);
-	for (int i = 0; i < setFour.number; i++) {
-		Item innerSet[3];
-		// Read Sets 1-3 (0x0, length = 0x18)
-		for (int j = 0; j < 3; j++) {
-			innerSet[j] = readItem(original, converted);
-		}
-		uint32_t savePos = ftell(original);
+	convertRecords<mysteryTwelveSetFourSchema>(stage, setFour.offset, setFour.number);
 
+	uint32_t set;
+	for (int i = 0; i < setFour.number && recordOffset(stage, setFour.offset, i, mysteryTwelveSetFourSchema.size, &set); i++) {
 		// 1/2/3/4/5/6
 		for (int j = 0; j < 3; j++) {
-			fseek(original, innerSet[j].offset, SEEK_SET);
-			fseek(converted, innerSet[j].offset, SEEK_SET);
-
-			for (int k = 0; k < innerSet[j].number; k++) {
-				// One (0x0, length = 0x4)
-				writeInt(converted, readInt(original));
-
-				// Four Floats? (0x4, length = 0x10)
-				writeInt(converted, readInt(original));
-				writeInt(converted, readInt(original));
-				writeInt(converted, readInt(original));
-				writeInt(converted, readInt(original));
-			}
+			Item innerSet = readStageItem<Format>(stage, set, j * 0x8);
+			convertRecords<mysteryTwelveEntrySchema>(stage, innerSet.offset, innerSet.number);
 		}
-		fseek(original, savePos, SEEK_SET);
-		fseek(converted, savePos, SEEK_SET);
-	}
-}
-static void copyMysteryFourteens(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-	
-	// Three floats? (0x0, length = 0xC)
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
-
-	// Two Floats (use lower 2 bytes only?)? (0xC, length = 0x8)
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
-
-	// Unknown/Null (0x14, length = 0x40)
-	for (int i = 0; i < 0x40; i++) {
-		writeInt(converted, readInt(original));
 	}
 }
 
-static void copyMysteryFifteens(FILE *original, FILE *converted, Item item) {
+template <typename Format>
+static void copyMysteryFifteens(StageCursor *stage, Item item) {
 	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	stage->position = item.offset;
 	return; // TODO Not done yet
 	for (int i = 0; i < item.number; i++) {
 		// Model Name offset (0x0, length = 0x4)
-		uint32_t modelNameOffset = readInt(original);
-		writeInt(converted, modelNameOffset);
+		convertInt<Format>(stage);
 
 		// Unknown/Null (0x4, length = 0x4)
-		writeInt(converted, readInt(original));
+		convertInt<Format>(stage);
 
 		// Four floats? (0x8, length = 0x10)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
+		convertInt<Format>(stage);
+		convertInt<Format>(stage);
+		convertInt<Format>(stage);
+		convertInt<Format>(stage);
 
 		// Unknown/Null (0x18, length = 0x10)
 		for (int j = 0; j < 0x10; j++) {
-			writeInt(converted, readInt(original));
+			convertInt<Format>(stage);
 		}
 
 		// Sets
 	}
 }
-static void copyReflectiveModels(FILE *original, FILE *converted, Item item) {
+template <typename Format>
+static void copyReflectiveModels(StageCursor *stage, Item item) {
 	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	if (!convertRecords<reflectiveModelSchema>(stage, item.offset, item.number) && skipVisitedChildren(stage)) return;
 
-	for (int i = 0; i < item.number; i++) {
-		// Model Name offset (0x0, length = 0x4)
-		uint32_t modelNameOffset = readInt(original);
-		writeInt(converted, modelNameOffset);
-
-		// Null/Padding (0x4, length = 0x8)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-
-		if (modelNameOffset != 0) {
-			// Copy model name
-			copyAsciiAligned(original, converted, modelNameOffset);
-		}
+	uint32_t model;
+	for (int i = 0; i < item.number && recordOffset(stage, item.offset, i, reflectiveModelSchema.size, &model); i++) {
+		// Copy model name
+		copyAsciiAligned(stage, readStageInt<Format>(stage, model, 0x0));
 	}
 }
-static void copyModelDuplicates(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-	
-	for (int i = 0; i < item.number; i++) {
-		// Offset to level model A (0x0, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Position? (0x4, length = 0xC)
-		writeInt(converted, readInt(original)); // X?
-		writeInt(converted, readInt(original)); // Y?
-		writeInt(converted, readInt(original)); // Z?
 
-		// Rotation?? (0x10, length = 0x8)
-		writeShort(converted, readShort(original)); // Unknown X?
-		writeShort(converted, readShort(original)); // Has Value Y
-		writeShort(converted, readShort(original)); // Unknown Z?
-		writeShort(converted, readShort(original)); // Unknown Padding?
-
-		// Scale? (0x18, length = 0xC)
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-		writeInt(converted, readInt(original));
-	}
-}
-static void copyLevelModelAs(FILE *original, FILE *converted, Item item) {
+template <typename Format>
+static void copyLevelModelAs(StageCursor *stage, Item item) {
 	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-
-	for (int i = 0; i < item.number; i++) {
-		// Level Model A Symbol (0x0, length = 0x8)
-		writeInt(converted, readInt(original)); // 0
-		writeInt(converted, readInt(original)); // 1
-
-		// Offset to Level Model A (Actual) (0x0, length = 0x4)
-		uint32_t levelModelAOffset = readInt(original);
-		writeInt(converted, levelModelAOffset);
-
-		uint32_t savePos = ftell(original);
-		// Seek to the actual Level Model A
-		fseek(original, levelModelAOffset, SEEK_SET);
-		fseek(converted, levelModelAOffset, SEEK_SET);
-
-		// Null (0x0, length = 4)
-		writeInt(converted, readInt(original));
-
-		// Model Name offset (0x4, length = 4)
-		uint32_t modelNameOffset = readInt(original);
-		writeInt(converted, modelNameOffset);
-
-		// Null/Padding (0x8, length = 4)
-		writeInt(converted, readInt(original));
-
-		// Float (Sometimes 0x41F00000) (0xC, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		if (modelNameOffset != 0) {
-			// Copy model name
-			copyAsciiAligned(original, converted, modelNameOffset);
-		}
+	if (!convertRecords<levelModelASchema>(stage, item.offset, item.number) && skipVisitedChildren(stage)) return;
 
-		fseek(original, savePos, SEEK_SET);
-		fseek(converted, savePos, SEEK_SET);
-	}
-}
-static void copyLevelModelBs(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	uint32_t model;
+	for (int i = 0; i < item.number && recordOffset(stage, item.offset, i, levelModelASchema.size, &model); i++) {
+		// The actual Level Model A
+		uint32_t levelModelAOffset = readStageInt<Format>(stage, model, 0x8);
+		if (!convertRecords<levelModelAActualSchema>(stage, levelModelAOffset, 1) && skipVisitedChildren(stage)) continue;
 
-	for (int i = 0; i < item.number; i++) {
-		// Offset to Level Model A (0x0, length = 0x4)
-		writeInt(converted, readInt(original)); // Not saved because the Level Model A readion covers it
+		// Copy model name
+		copyAsciiAligned(stage, readStageInt<Format>(stage, levelModelAOffset, 0x4));
 	}
 }
-static void copySwitches(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
 
-	// Loop through switches
-	for (int i = 0; i < item.number; i++) {
-		// Position (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
+template <typename Format>
+static void copyCollisionField(StageCursor *stage, uint32_t field) {
+	// Time for a duplicate of most of the file header
+	// Technically the lists can point to different places...
+	// (Goals at 0x44 aren't copied)
+	copyCollisionAnimation<Format>(stage, readStageInt<Format>(stage, field, 0x14));
+	
+	copyList<bumperSchema>(stage, readStageItem<Format>(stage, field, 0x4C));
+	
+	copyList<jamabarSchema>(stage, readStageItem<Format>(stage, field, 0x54));
 
-		// Rotation (0xC, length = 0x6)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
+	copyList<bananaSchema>(stage, readStageItem<Format>(stage, field, 0x5C));
 
-		// Switch type (0x12, length = 0x2)
-		writeShort(converted, readShort(original)); // Switch Type
+	copyList<coneCollisionSchema>(stage, readStageItem<Format>(stage, field, 0x64));
 
-		// Animation Group IDs affected (0x14, length = 0x2)
-		writeShort(converted, readShort(original)); // Group IDs
+	copyList<sphereCollisionSchema>(stage, readStageItem<Format>(stage, field, 0x6C));
 
-		// Padding/Null (0x16, length = 0x2)
-		writeShort(converted, readShort(original));
-	}
-}
-static void copyFogAnimation(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	const int numKeys = 6;
-	uint32_t savePos = ftell(original);
+	copyList<cylinderCollisionSchema>(stage, readStageItem<Format>(stage, field, 0x74));
 
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-	Item keyList[6];
+	copyList<falloutVolumeSchema>(stage, readStageItem<Format>(stage, field, 0x7C));
+	
+	copyReflectiveModels<Format>(stage, readStageItem<Format>(stage, field, 0x84));
 
-	// Gather keys (0x0, length = 0x8 * numKeys
-	for (int i = 0; i < numKeys; i++) {
-		keyList[i].number = readInt(original);
-		keyList[i].offset = readInt(original);
-		writeInt(converted, keyList[i].number);
-		writeInt(converted, keyList[i].offset);
-	}
+	copyList<modelDuplicateSchema>(stage, readStageItem<Format>(stage, field, 0x8C));
 
-	// Unknown/Null (0x8 * numKeys, length = 0x30 - (0x8 * numKeys)
-	for (int i = numKeys * 0x8; i < 0x30; i += 4) {
-		writeInt(converted, readInt(original));
-	}
+	copyList<levelModelBSchema>(stage, readStageItem<Format>(stage, field, 0x94));
 
-	for (int i = 0; i < numKeys; i++) {
-		if (keyList[i].number > 0 && keyList[i].offset != 0) {
+	copyList<switchSchema>(stage, readStageItem<Format>(stage, field, 0xA8));
 
-			fseek(original, keyList[i].offset, SEEK_SET);
-			fseek(converted, keyList[i].offset, SEEK_SET);
+	copyRecord<mysteryFiveSchema>(stage, readStageInt<Format>(stage, field, 0xB4));
 
-			for (int j = 0; j < keyList[i].number; j++) {
-				// Easing (0x0, length = 0x4)
-				writeInt(converted, readInt(original));
+	copyWormholes(stage, readStageItem<Format>(stage, field, 0xC4));
 
-				// Time (0x4, length = 0x4)
-				writeInt(converted, readInt(original));
+	copyRecord<mysteryElevenSchema>(stage, readStageInt<Format>(stage, field, 0xD8));
+	
+	// Only convert exactly the grid specified
+	// and only up to the last used collision triangle index
+	// This avoids making assumptions about file order
+	// in order to approximate section size
+	uint32_t collisionTriangleListOffset = readStageInt<Format>(stage, field, 0x24);
+	uint32_t collisionTriangleGridOffset = readStageInt<Format>(stage, field, 0x28);
+	uint32_t xStepCount = readStageInt<Format>(stage, field, 0x3C);
+	uint32_t zStepCount = readStageInt<Format>(stage, field, 0x40);
 
-				// Value (0x8, length = 0x4)
-				writeInt(converted, readInt(original));
+	uint32_t maxTriangleIndex = copyCollisionTriangleGrid<Format>(stage, collisionTriangleGridOffset, xStepCount, zStepCount);
 
-				// Unknown/Null (0xC, length = 0x8)
-				for (int k = 0; k < 0x8; k += 4) {
-					writeInt(converted, readInt(original));
-				}
-			}
-		}
+	// Collision Triangles are 0 indexed
+	// Because of that a max index of ie 10 must include 10 here
+	if (collisionTriangleListOffset != 0) {
+		convertCollisionTriangles(stage, collisionTriangleListOffset, maxTriangleIndex + 1);
 	}
-
-	fseek(original, savePos, SEEK_SET);
-	fseek(converted, savePos, SEEK_SET);
 }
-static void copyWormholes(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
 
-	// Loop through wormholes
-	for (int i = 0; i < item.number; i++) {
-		// Wormhole ID (1) (0x0, length = 0x4)
-		// Every second wormhole has this as a marker (no endianness change)
-		if (i % 2 == 0) {
-			writeInt(converted, readInt(original));
+// Sorts and merges overlapping/adjacent regions
+static void mergeRegions(std::vector<StageRegion> *regions) {
+	std::sort(regions->begin(), regions->end(), [](const StageRegion &a, const StageRegion &b) { return a.start < b.start; });
+	size_t merged = 0;
+	for (size_t i = 0; i < regions->size(); ++i) {
+		if (merged != 0 && (*regions)[i].start <= (*regions)[merged - 1].end) {
+			if ((*regions)[i].end > (*regions)[merged - 1].end) {
+				(*regions)[merged - 1].end = (*regions)[i].end;
+			}
 		}
 		else {
-			writeNormalInt(converted, readInt(original));
+			(*regions)[merged++] = (*regions)[i];
 		}
-
-		// Position (0x4, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
-
-		// Rotation (0x10, length = 0x8)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-		writeShort(converted, readShort(original)); // Padding/Null
-
-		// Offset to destination wormwhole (0x18, length = 0x4)
-		writeInt(converted, readInt(original));
 	}
+	regions->resize(merged);
 }
-static void copyFog(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-
-	// Fog Id Marker (0x0, length = 0x4, marker)
-	writeNormalInt(converted, readInt(original));
-
-	// Distance (0x4, length = 0x8)
-	writeNormalInt(converted, readInt(original)); // Start Distance
-	writeNormalInt(converted, readInt(original)); // End Distance
-
-	// Color (0xC, length = 0xC)
-	writeNormalInt(converted, readInt(original)); // Red
-	writeNormalInt(converted, readInt(original)); // Green
-	writeNormalInt(converted, readInt(original)); // Blue
 
-	// Unknown/Null (0x18, length = 0xC)
-	for (int i = 0; i < 0xC; i += 4) {
-		writeInt(converted, readInt(original));
+// Marks every field that wrote a byte another field also wrote
+static void findOverlappingFields(std::vector<std::vector<StageRegion> > *written, std::vector<bool> *overlapping) {
+	typedef struct {
+		uint32_t start;
+		uint32_t end;
+		uint32_t field;
+	}FieldRegion;
+
+	std::vector<FieldRegion> regions;
+	for (size_t i = 0; i < written->size(); ++i) {
+		mergeRegions(&(*written)[i]);
+		for (size_t j = 0; j < (*written)[i].size(); ++j) {
+			FieldRegion region = { (*written)[i][j].start, (*written)[i][j].end, (uint32_t)i };
+			regions.push_back(region);
+		}
 	}
-}
-static void copyMysteryThrees(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-	
-	// Position? (0x0, length = 0xC)
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
-
-	// Some Symbol (0xC, length = 0x4)
-	writeShort(converted, readShort(original)); // Unknown/Null
-	writeShort(converted, readShort(original)); // The marker value
-
-	// Unknown/Null (0x10, length = 0x14)
-	for (int i = 0; i < 0x14; i += 4) {
-		writeInt(converted, readInt(original));
+	std::sort(regions.begin(), regions.end(), [](const FieldRegion &a, const FieldRegion &b) { return a.start < b.start; });
+
+	// The region reaching furthest so far contains any point an earlier region shares with the current one
+	uint32_t furthestEnd = 0;
+	uint32_t furthestField = 0;
+	for (size_t i = 0; i < regions.size(); ++i) {
+		if (i != 0 && regions[i].start < furthestEnd) {
+			(*overlapping)[regions[i].field] = true;
+			(*overlapping)[furthestField] = true;
+		}
+		if (i == 0 || regions[i].end > furthestEnd) {
+			furthestEnd = regions[i].end;
+			furthestField = regions[i].field;
+		}
 	}
 }
-static void copyMysteryFive(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-
-	// Unknown/Null (0x0, length = 0x4)
-	writeInt(converted, readInt(original));
 
-	// Unknown/Floats (0x4, length = 0xC)
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
-	writeInt(converted, readInt(original));
-}
-static void copyMysteryElevens(FILE *original, FILE *converted, Item item) {
+template <typename Format>
+static void copyCollisionFields(StageCursor *stage, Item item) {
 	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
+	convertRecords<collisionFieldSchema>(stage, item.offset, item.number);
 
-	// Float? (0x0, length = 0x4)
-	writeInt(converted, readInt(original));
-
-	// Unknown/Null (0x4, length = 0x4)
-	writeInt(converted, readInt(original));
-}
-static void copyCollisionFields(FILE *original, FILE *converted, Item item) {
-	if (item.offset == 0) return;
-	fseek(original, item.offset, SEEK_SET);
-	fseek(converted, item.offset, SEEK_SET);
-
-	for (int i = 0; i < item.number; i++) {
-		// Center of Rotation (0x0, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
-
-		// Initial Rotation (0xC, length = 0x6)
-		writeShort(converted, readShort(original)); // X
-		writeShort(converted, readShort(original)); // Y
-		writeShort(converted, readShort(original)); // Z
-
-		// Animatione loop type/seesaw (0x12, length = 0x2)
-		writeShort(converted, readShort(original));
-
-		// Animation Offset (0x14, length = 0x4)
-		uint32_t animationOffset = readInt(original);
-		writeInt(converted, animationOffset);
-
-		// Conveyor Speed (0x18, length = 0xC)
-		writeInt(converted, readInt(original)); // X
-		writeInt(converted, readInt(original)); // Y
-		writeInt(converted, readInt(original)); // Z
-
-		// Collision triangle information (0x24, length = 0x8)
-		uint32_t collisionTriangleListOffset = readInt(original);
-		writeInt(converted, collisionTriangleListOffset);
-
-		uint32_t collisionTriangleGridOffset = readInt(original);
-		writeInt(converted, collisionTriangleGridOffset);
-
-		// Grid Paramters (0x2C, length = 0x10)
-		writeInt(converted, readInt(original)); // X Start
-
-		writeInt(converted, readInt(original)); // Z Start
-
-		writeInt(converted, readInt(original)); // X Step
-
-		writeInt(converted, readInt(original)); // Z Step
-		
-		// Grid Step Counts (0x3C, length = 0x8)
-		uint32_t xStepCount = readInt(original);
-		writeInt(converted, xStepCount);
-
-		uint32_t zStepCount = readInt(original);
-		writeInt(converted, zStepCount);
-
-		// Time for a duplicate of most of the file header
-		// Technically the lists can point to different places...
-		Item goals;
-		Item bumpers;
-		Item jamabars;
-		Item bananas;
-		Item coneCollisions;
-		Item sphereCollisions;
-		Item cylinderCollisions;
-		Item falloutVolumes;
-		Item reflectiveModels;
-		Item modelDuplicates;
-		Item levelModelB;
-		Item switches;
-		Item wormholes;
-		Item mysteryFive;
-		Item mysteryEleven;
-
-		// Goals (0x44, length = 0x8)
-		goals = readItem(original, converted);
-		
-		// Bumpers (0x4C, length = 0x8)
-		bumpers = readItem(original, converted);
-		
-		// Jamabars (0x54, length = 0x8)
-		jamabars = readItem(original, converted);
-
-		// Bananas (0x5C, length = 0x8)
-		bananas = readItem(original, converted);
-
-		// Cone Collisions (0x64, length = 0x8)
-		coneCollisions = readItem(original, converted);
-
-		// Sphere Collisions (0x6C, length = 0x8)
-		sphereCollisions = readItem(original, converted);
-
-		// Cylinder Collisions (0x74, length = 0x8)
-		cylinderCollisions = readItem(original, converted);
-
-		// Fallout Volumes (0x7C, length = 0x8)
-		falloutVolumes = readItem(original, converted);
-		
-		// Reflective Models (0x84, length = 0x8)
-		reflectiveModels = readItem(original, converted);
-
-		// Model Duplicates (0x8C, length = 0x8)
-		modelDuplicates = readItem(original, converted);
-
-		// Level Model Type Bs (0x94, length = 0x8)
-		levelModelB = readItem(original, converted);
+	std::vector<uint32_t> fields;
+	uint32_t field;
+	for (int i = 0; i < item.number && recordOffset(stage, item.offset, i, collisionFieldSchema.size, &field); i++) {
+		fields.push_back(field);
+	}
 
-		// Unknown/Null (0x9C, length = 0x8)
-		for (int j = 0; j < 0x8; j += 4) {
-			writeInt(converted, readInt(original));
+	if (stage->pool == NULL || fields.size() < 2) {
+		for (size_t i = 0; i < fields.size(); i++) {
+			copyCollisionField<Format>(stage, fields[i]);
 		}
+		return;
+	}
 
-		// Animation Group ID (0xA4, length = 0x4, marker?)
-		writeShort(converted, readShort(original));
-		writeShort(converted, readShort(original));
-
-		// Switches (0xA8, length = 0x8)
-		switches = readItem(original, converted);
-
-		// Unknown/Null (0xB0, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Mystery Five (0xB4, length = 0x4)
-		mysteryFive.offset = readInt(original);
-		writeInt(converted, mysteryFive.offset);
-
-		// Seesaw (0xB8, length = 0xC)
-		writeInt(converted, readInt(original)); // Sensitivity
-		writeInt(converted, readInt(original)); // Reset Stiffness
-		writeInt(converted, readInt(original)); // Bounds of Rotation
-		
-		// Wormholes (0xC4, length = 0x8)
-		wormholes = readItem(original, converted);
-
-		// Initial Animation State (0xCC, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Unknown/Null (0xD0, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Animation Loop Point (0xD4, length = 0x4)
-		writeInt(converted, readInt(original));
-
-		// Mystery Eleven (0xD8, length = 0x4)
-		mysteryEleven.offset = readInt(original);
-		writeInt(converted, mysteryEleven.offset);
-
-		// Unknown/Null (0xDC, length = 0x3C0)
-		for (int j = 0; j < 0x3C0; j += 4) {
-			writeInt(converted, readInt(original));
+	// Everything a field points to is converted on its own, so fields run as separate tasks with their own cursors
+	std::vector<std::vector<StageRegion> > written(fields.size());
+	WorkGroup group;
+	initWorkGroup(&group);
+	for (size_t i = 0; i < fields.size(); i++) {
+		StageCursor fieldStage = *stage;
+		fieldStage.written = &written[i];
+		uint32_t fieldOffset = fields[i];
+		addGroupWork(stage->pool, &group, [fieldStage, fieldOffset]() mutable {
+			copyCollisionField<Format>(&fieldStage, fieldOffset);
+		});
+	}
+	waitWorkGroup(stage->pool, &group);
+
+	// Fields whose data overlaps (ex. an int in one is a short in another) may have been written in any order
+	// Convert those again in order so the last field wins like it does on one thread
+	std::vector<bool> overlapping(fields.size(), false);
+	findOverlappingFields(&written, &overlapping);
+	// Which task got to shared data first isn't known, so nothing is skipped
+	StageCursor orderedStage = *stage;
+	orderedStage.visited = NULL;
+	for (size_t i = 0; i < fields.size(); i++) {
+		if (overlapping[i]) {
+			copyCollisionField<Format>(&orderedStage, fields[i]);
 		}
-
-		uint32_t savePos = ftell(original);
-
-		// Copy the fun items...
-		copyAnimation(original, converted, animationOffset, 6, 0x123456);
-		
-		copyBumpers(original, converted, bumpers);
-		
-		copyJamabars(original, converted, jamabars);
-
-		copyBananas(original, converted, bananas);
-
-		copyConeCollisions(original, converted, coneCollisions);
-
-		copySphereCollisions(original, converted, sphereCollisions);
-
-		copyCylinderCollisions(original, converted, cylinderCollisions);
-
-		copyFalloutVolumes(original, converted, falloutVolumes);
-		
-		copyReflectiveModels(original, converted, reflectiveModels);
-
-		copyModelDuplicates(original, converted, modelDuplicates);
-
-		copyLevelModelBs(original, converted, levelModelB);
-
-		copySwitches(original, converted, switches);
-
-		copyMysteryFive(original, converted, mysteryFive);
-
-		copyWormholes(original, converted, wormholes);
-
-		copyMysteryElevens(original, converted, mysteryEleven);
-		
-		// Only convert exactly the grid specified
-		// and only up to the last used collision triangle index
-		// This avoids making assumptions about file order
-		// in order to approximate section size
-		uint32_t maxTriangleIndex = copyCollisionTriangleGrid(original, converted, collisionTriangleGridOffset, xStepCount, zStepCount);
-		copyCollisionTriangles(original, converted, collisionTriangleListOffset, maxTriangleIndex);
-		
-		fseek(original, savePos, SEEK_SET);
-		fseek(converted, savePos, SEEK_SET);
 	}
-}
\ No newline at end of file
+}
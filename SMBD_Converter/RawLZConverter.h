@@ -1,3 +1,36 @@
 #pragma once
 
-void parseRawLZ(const char* filename);
\ No newline at end of file
+#include <stdint.h>
+#include "ConversionContext.h"
+#include "WorkPool.h"
+
+// Converts a raw lz file to the other game and writes it next to the original (.smb2/.smbd)
+void parseRawLZ(const char* filename);
+
+// Converts a raw lz image in memory
+// output must be the same size as input
+// Returns the game input is from (SMB2/SMBD) or -1 if it can't be converted
+int convertRawLZ(const uint8_t* input, uint32_t size, uint8_t* output);
+
+// Same as above but converts from the given game (SMB2/SMBD) instead of detecting it
+// Collision fields are converted in parallel on pool unless it's NULL
+int convertRawLZ(const uint8_t* input, uint32_t size, uint8_t* output, int game, WorkPool *pool);
+
+// Converts a raw lz image from the given game (SMB2/SMBD) over itself, the result is the same as converting into a new buffer
+// Only conversions with data read two ways need a copy of the image (converted from the copy on pool)
+// Returns the game data was from or -1 if it can't be converted
+int convertRawLZInPlace(uint8_t* data, uint32_t size, int game, WorkPool *pool);
+
+// Converts the raw lz in context->input straight into convertedFilename(context) without a second buffer the size of the stage
+// The pointers are walked first to plan every record, then the stage is converted and written front to back a chunk at a time
+// (the input is read in one forward pass instead of following every pointer)
+// Returns 0 on success or -1 on error
+int convertRawLZToFile(ConversionContext *context);
+
+// Converts the raw lz in context->input into context->output (or over context->input if context->inPlace is set)
+// Returns 0 on success or -1 on error
+int convertRawLZ(ConversionContext *context);
+
+// Decompresses the .lz in context->input, converts it and recompresses it if context->recompress is set
+// Returns 0 on success or -1 on error
+int convertLZ(ConversionContext *context);
@@ -0,0 +1,174 @@
+#include "StageGraph.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <string>
+#include <map>
+#include <algorithm>
+
+// Sidecar format (little endian)
+// "SGPH", version, game, size, schema count, node count, edge count
+// then each schema name (length, characters), each node (start, end, schema) and each edge (field, from, to)
+#define STAGE_GRAPH_MAGIC 0x48504753
+#define STAGE_GRAPH_VERSION 1
+
+int findStageNode(const StageGraph *graph, uint32_t offset) {
+	// Last node starting at or before offset
+	std::vector<StageNode>::const_iterator node = std::upper_bound(graph->nodes.begin(), graph->nodes.end(), offset,
+		[](uint32_t value, const StageNode &node) { return value < node.start; });
+
+	// Nodes only nest when data was read two ways, so this rarely looks back more than once
+	while (node != graph->nodes.begin()) {
+		--node;
+		if (offset < node->end) {
+			return (int)(node - graph->nodes.begin());
+		}
+	}
+	return -1;
+}
+
+const StageEdge* stageNodeEdges(const StageGraph *graph, uint32_t node, uint32_t *count) {
+	const StageNode *stageNode = &graph->nodes[node];
+	*count = stageNode->edgeCount;
+	return stageNode->edgeCount == 0 ? NULL : &graph->edges[stageNode->firstEdge];
+}
+
+void saveStageGraph(const StageGraph *graph, std::vector<uint8_t> *output) {
+	// Schemas used, in order of first use
+	std::vector<const RecordSchema*> schemas;
+	std::map<std::string, uint32_t> schemaIndex;
+	std::vector<uint32_t> nodeSchemas(graph->nodes.size());
+	for (size_t i = 0; i < graph->nodes.size(); ++i) {
+		const RecordSchema *schema = graph->nodes[i].schema;
+		std::map<std::string, uint32_t>::iterator found = schemaIndex.find(schema->name);
+		if (found == schemaIndex.end()) {
+			found = schemaIndex.insert(std::make_pair(std::string(schema->name), (uint32_t)schemas.size())).first;
+			schemas.push_back(schema);
+		}
+		nodeSchemas[i] = found->second;
+	}
+
+	output->clear();
+	OutputStream stream = { output, 0 };
+	writeLittleInt(&stream, STAGE_GRAPH_MAGIC);
+	writeLittleInt(&stream, STAGE_GRAPH_VERSION);
+	writeLittleInt(&stream, (uint32_t)graph->game);
+	writeLittleInt(&stream, graph->size);
+	writeLittleInt(&stream, (uint32_t)schemas.size());
+	writeLittleInt(&stream, (uint32_t)graph->nodes.size());
+	writeLittleInt(&stream, (uint32_t)graph->edges.size());
+
+	for (size_t i = 0; i < schemas.size(); ++i) {
+		size_t length = strlen(schemas[i]->name);
+		writeLittleInt(&stream, (uint32_t)length);
+		for (size_t j = 0; j < length; ++j) {
+			writeByte(&stream, schemas[i]->name[j]);
+		}
+	}
+	for (size_t i = 0; i < graph->nodes.size(); ++i) {
+		writeLittleInt(&stream, graph->nodes[i].start);
+		writeLittleInt(&stream, graph->nodes[i].end);
+		writeLittleInt(&stream, nodeSchemas[i]);
+	}
+	for (size_t i = 0; i < graph->edges.size(); ++i) {
+		writeLittleInt(&stream, graph->edges[i].field);
+		writeLittleInt(&stream, graph->edges[i].from);
+		writeLittleInt(&stream, graph->edges[i].to);
+	}
+}
+
+bool loadStageGraph(const uint8_t *data, size_t size, StageGraph *graph) {
+	InputStream stream = { data, size, 0 };
+	if (size < 28 || readLittleInt(&stream) != STAGE_GRAPH_MAGIC || readLittleInt(&stream) != STAGE_GRAPH_VERSION) {
+		return false;
+	}
+	graph->game = (int)readLittleInt(&stream);
+	graph->size = readLittleInt(&stream);
+	uint32_t schemaCount = readLittleInt(&stream);
+	uint32_t nodeCount = readLittleInt(&stream);
+	uint32_t edgeCount = readLittleInt(&stream);
+
+	std::vector<const RecordSchema*> schemas;
+	for (uint32_t i = 0; i < schemaCount; ++i) {
+		uint32_t length = readLittleInt(&stream);
+		if (stream.position + length > size) return false;
+		std::string name((const char*)&data[stream.position], length);
+		stream.position += length;
+		const RecordSchema *schema = findStageSchema(name.c_str());
+		if (schema == NULL) return false;
+		schemas.push_back(schema);
+	}
+	if ((uint64_t)nodeCount * 12 + (uint64_t)edgeCount * 12 != size - stream.position) {
+		return false;
+	}
+
+	graph->nodes.resize(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; ++i) {
+		StageNode *node = &graph->nodes[i];
+		node->start = readLittleInt(&stream);
+		node->end = readLittleInt(&stream);
+		uint32_t schema = readLittleInt(&stream);
+		if (schema >= schemas.size()) return false;
+		node->schema = schemas[schema];
+		node->firstEdge = 0;
+		node->edgeCount = 0;
+	}
+	graph->edges.resize(edgeCount);
+	for (uint32_t i = 0; i < edgeCount; ++i) {
+		StageEdge *edge = &graph->edges[i];
+		edge->field = readLittleInt(&stream);
+		edge->from = readLittleInt(&stream);
+		edge->to = readLittleInt(&stream);
+		if (edge->from >= nodeCount || edge->to >= nodeCount || (i > 0 && edge->from < graph->edges[i - 1].from)) return false;
+
+		StageNode *from = &graph->nodes[edge->from];
+		if (from->edgeCount == 0) {
+			from->firstEdge = i;
+		}
+		from->edgeCount++;
+	}
+	return true;
+}
+
+void beginStageWalk(StageGraphWalk *walk, const StageGraph *graph, uint32_t root) {
+	walk->graph = graph;
+	walk->pending.clear();
+	walk->seen.assign(graph->nodes.size(), false);
+	walk->lastChildren = 0;
+	if (root < graph->nodes.size()) {
+		walk->pending.push_back(root);
+		walk->seen[root] = true;
+	}
+}
+
+int nextStageNode(StageGraphWalk *walk) {
+	if (walk->pending.empty()) {
+		walk->lastChildren = 0;
+		return -1;
+	}
+	uint32_t node = walk->pending.back();
+	walk->pending.pop_back();
+	walk->lastChildren = walk->pending.size();
+
+	// Pushed last to first so they come back out in file order
+	uint32_t count;
+	const StageEdge *edges = stageNodeEdges(walk->graph, node, &count);
+	for (uint32_t i = count; i > 0; --i) {
+		uint32_t child = edges[i - 1].to;
+		if (!walk->seen[child]) {
+			walk->seen[child] = true;
+			walk->pending.push_back(child);
+		}
+	}
+	return (int)node;
+}
+
+void skipStageNodeChildren(StageGraphWalk *walk) {
+	for (size_t i = walk->lastChildren; i < walk->pending.size(); ++i) {
+		// Still reachable another way
+		walk->seen[walk->pending[i]] = false;
+	}
+	walk->pending.resize(walk->lastChildren);
+}
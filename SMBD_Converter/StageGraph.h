@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "FunctionsAndDefines.h"
+#include "StageSchemas.h"
+
+// Every region of a raw lz stage and the pointers between them, found in one walk of the stage
+// Built once, it can be saved next to the stage and walked again without reading the stage (ie: to validate or extract part of it)
+
+// Records of one schema read back to back from start
+typedef struct {
+	uint32_t start;
+	uint32_t end;
+	const RecordSchema *schema;
+	// Pointers inside this node are edges [firstEdge, firstEdge + edgeCount)
+	uint32_t firstEdge;
+	uint32_t edgeCount;
+}StageNode;
+
+// A pointer field and the node it points to
+typedef struct {
+	// Offset of the field in the file
+	uint32_t field;
+	// Node indices
+	uint32_t from;
+	uint32_t to;
+}StageEdge;
+
+typedef struct {
+	// Game the stage was read from
+	int game;
+	// Size of the raw lz
+	uint32_t size;
+	// By start (node 0 is the stage header)
+	std::vector<StageNode> nodes;
+	// By from, then field
+	std::vector<StageEdge> edges;
+}StageGraph;
+
+// Walks a raw lz into graph (defined with the conversion in RawLZConverter.cpp, which walks the stage the same way)
+// game is SMB2/SMBD or -1 to detect it
+// Returns the game it was read as or -1 if the stage header isn't there
+int buildStageGraph(const uint8_t *input, uint32_t size, int game, StageGraph *graph);
+
+// Index of the innermost node containing offset, or -1 if none does
+int findStageNode(const StageGraph *graph, uint32_t offset);
+
+// Pointers inside node (count of them in *count)
+const StageEdge* stageNodeEdges(const StageGraph *graph, uint32_t node, uint32_t *count);
+
+// Saves graph as a sidecar file (<stage>.graph), schemas are saved by name
+void saveStageGraph(const StageGraph *graph, std::vector<uint8_t> *output);
+
+// Reads a graph saved by saveStageGraph
+// Returns false if data isn't a saved graph (or uses a schema that doesn't exist anymore)
+bool loadStageGraph(const uint8_t *data, size_t size, StageGraph *graph);
+
+#pragma region Traversal
+
+// Depth first walk over the nodes reachable from a root
+// A node's pointers are only looked at once the node is returned, so a walk can stop (or skip a subtree) at any point
+typedef struct {
+	const StageGraph *graph;
+	// Nodes waiting to be returned
+	std::vector<uint32_t> pending;
+	std::vector<bool> seen;
+	// pending size before the last returned node's children were added
+	size_t lastChildren;
+}StageGraphWalk;
+
+void beginStageWalk(StageGraphWalk *walk, const StageGraph *graph, uint32_t root);
+
+// Next node (in the order the pointers are in the file), or -1 once everything reachable was returned
+int nextStageNode(StageGraphWalk *walk);
+
+// Doesn't follow the pointers of the node nextStageNode last returned
+void skipStageNodeChildren(StageGraphWalk *walk);
+
+#pragma endregion Traversal
@@ -0,0 +1,153 @@
+#include "StageModel.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <algorithm>
+
+// Copies the first length bytes of back to back records, a field cut off by length isn't copied (like swapSchemaRecords)
+static void copyStageData(const RecordSchema *schema, const uint8_t *input, uint8_t *output, uint32_t length) {
+	uint32_t start = length / schema->size * schema->size;
+	memcpy(output, input, start);
+
+	for (uint32_t i = 0; i < schema->fieldCount; i++) {
+		const FieldSchema *field = &schema->fields[i];
+		if (start + field->offset >= length) break;
+
+		uint32_t count = (length - start - field->offset) / field->width;
+		if (count > field->count) count = field->count;
+		memcpy(&output[start + field->offset], &input[start + field->offset], count * field->width);
+	}
+}
+
+void initStage(Stage *stage, int game, uint32_t size) {
+	stage->game = game;
+	stage->size = size;
+	stage->kinds.clear();
+	stage->kindIndex.clear();
+	stage->order.clear();
+}
+
+void addStageRecords(Stage *stage, const RecordSchema *schema, const uint8_t *input, uint32_t offset, uint32_t length) {
+	if (length == 0) return;
+
+	uint32_t kind;
+	std::map<std::string, uint32_t>::iterator found = stage->kindIndex.find(schema->name);
+	if (found == stage->kindIndex.end()) {
+		kind = (uint32_t)stage->kinds.size();
+		stage->kindIndex[schema->name] = kind;
+		stage->kinds.push_back(StageRecords());
+		stage->kinds[kind].schema = schema;
+		stage->kinds[kind].count = 0;
+	}
+	else {
+		kind = found->second;
+	}
+	StageRecords *records = &stage->kinds[kind];
+
+	uint32_t count = (length + schema->size - 1) / schema->size;
+	size_t dataStart = records->data.size();
+	records->data.resize(dataStart + (size_t)count * schema->size);
+	if (stage->game == SMBD) {
+		copyStageData(schema, &input[offset], &records->data[dataStart], length);
+	}
+	else {
+		swapSchemaRecords(schema, &input[offset], &records->data[dataStart], length);
+	}
+
+	// Records right after the last run read (ie: triangle lists next to each other) extend it
+	if (!stage->order.empty() && stage->order.back().kind == kind) {
+		StageRun *last = &records->runs.back();
+		if (last->offset + last->length == offset && last->length == last->count * schema->size) {
+			last->count += count;
+			last->length += length;
+			records->count += count;
+			return;
+		}
+	}
+
+	StageRun run = { offset, records->count, count, length };
+	StageRunOrder order = { kind, (uint32_t)records->runs.size() };
+	records->runs.push_back(run);
+	records->count += count;
+	stage->order.push_back(order);
+}
+
+void serializeStage(const Stage *stage, int game, uint8_t *output) {
+	memset(output, 0, stage->size);
+
+	for (size_t i = 0; i < stage->order.size(); i++) {
+		const StageRecords *records = &stage->kinds[stage->order[i].kind];
+		const StageRun *run = &records->runs[stage->order[i].run];
+		const uint8_t *data = &records->data[(size_t)run->first * records->schema->size];
+
+		// Records are kept in SMBD's byte order
+		if (game == SMBD) {
+			copyStageData(records->schema, data, &output[run->offset], run->length);
+		}
+		else {
+			swapSchemaRecords(records->schema, data, &output[run->offset], run->length);
+		}
+	}
+}
+
+void serializeStage(const Stage *stage, int game, std::vector<uint8_t> *output) {
+	output->resize(stage->size);
+	serializeStage(stage, game, output->data());
+}
+
+const StageRecords* findStageRecords(const Stage *stage, const RecordSchema &schema) {
+	std::map<std::string, uint32_t>::const_iterator found = stage->kindIndex.find(schema.name);
+	if (found == stage->kindIndex.end()) {
+		return NULL;
+	}
+	return &stage->kinds[found->second];
+}
+
+uint32_t stageRecordOffset(const StageRecords *records, uint32_t index) {
+	// Last run starting at or before index
+	std::vector<StageRun>::const_iterator run = std::upper_bound(records->runs.begin(), records->runs.end(), index,
+		[](uint32_t value, const StageRun &run) { return value < run.first; });
+	if (run == records->runs.begin() || index >= records->count) {
+		return 0xFFFFFFFF;
+	}
+	--run;
+	return run->offset + (index - run->first) * records->schema->size;
+}
+
+int findStageRecord(const StageRecords *records, uint32_t offset) {
+	if (records == NULL) return -1;
+	uint32_t size = records->schema->size;
+	for (size_t i = 0; i < records->runs.size(); i++) {
+		const StageRun *run = &records->runs[i];
+		if (offset >= run->offset && offset - run->offset < run->count * size && (offset - run->offset) % size == 0) {
+			return (int)(run->first + (offset - run->offset) / size);
+		}
+	}
+	return -1;
+}
+
+// Anything outside the records reads as all 1s (like reading past the end of the file)
+uint32_t stageRecordInt(const StageRecords *records, uint32_t index, uint32_t fieldOffset) {
+	uint64_t position = (uint64_t)index * records->schema->size + fieldOffset;
+	if (index >= records->count || fieldOffset + 4 > records->schema->size) {
+		return 0xFFFFFFFF;
+	}
+	return readLittleInt(&records->data[(size_t)position]);
+}
+
+uint16_t stageRecordShort(const StageRecords *records, uint32_t index, uint32_t fieldOffset) {
+	uint64_t position = (uint64_t)index * records->schema->size + fieldOffset;
+	if (index >= records->count || fieldOffset + 2 > records->schema->size) {
+		return 0xFFFF;
+	}
+	return readLittleShort(&records->data[(size_t)position]);
+}
+
+float stageRecordFloat(const StageRecords *records, uint32_t index, uint32_t fieldOffset) {
+	uint32_t value = stageRecordInt(records, index, fieldOffset);
+	float result;
+	memcpy(&result, &value, sizeof(result));
+	return result;
+}
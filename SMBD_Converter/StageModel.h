@@ -0,0 +1,189 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "FunctionsAndDefines.h"
+#include "StageSchemas.h"
+
+// A raw lz stage read once into arrays of records
+// Every record is kept little endian (SMBD order, the host order on PC) with markers and names as they are in the file,
+// so the arrays can be used directly as the typed structs below and written back out to either game
+
+// Records of one kind read back to back from offset (the last one may be cut off by the end of the file)
+typedef struct {
+	uint32_t offset;
+	// Index of the first record in StageRecords
+	uint32_t first;
+	uint32_t count;
+	// Bytes of the run inside the file
+	uint32_t length;
+}StageRun;
+
+// Every record of one schema in the stage, in the order they were found
+typedef struct {
+	const RecordSchema *schema;
+	uint32_t count;
+	// schema->size bytes per record
+	std::vector<uint8_t> data;
+	std::vector<StageRun> runs;
+}StageRecords;
+
+// Run run of kinds[kind]
+typedef struct {
+	uint32_t kind;
+	uint32_t run;
+}StageRunOrder;
+
+typedef struct {
+	// Game the stage was read from
+	int game;
+	// Size of the raw lz
+	uint32_t size;
+	// One entry per schema found
+	std::vector<StageRecords> kinds;
+	// By schema name (every source file has its own copy of the schemas)
+	std::map<std::string, uint32_t> kindIndex;
+	// Order the runs were read in, writing them back in this order gives the same bytes as converting
+	// (data read with two layouts is written with the last one)
+	std::vector<StageRunOrder> order;
+}Stage;
+
+void initStage(Stage *stage, int game, uint32_t size);
+
+// Adds the records of schema covering length bytes at offset of input (the whole raw lz read from stage->game)
+void addStageRecords(Stage *stage, const RecordSchema *schema, const uint8_t *input, uint32_t offset, uint32_t length);
+
+// Reads a raw lz into stage (defined with the conversion in RawLZConverter.cpp, which walks the stage the same way)
+// game is SMB2/SMBD or -1 to detect it
+// Returns the game it was read as or -1 if the stage header isn't there
+int parseStage(const uint8_t *input, uint32_t size, int game, Stage *stage);
+
+// Writes stage as a raw lz for game (SMB2/SMBD), output must be stage->size bytes
+// Anything that isn't part of a record is left as zeros
+void serializeStage(const Stage *stage, int game, uint8_t *output);
+
+void serializeStage(const Stage *stage, int game, std::vector<uint8_t> *output);
+
+// Records of schema (NULL if there are none)
+const StageRecords* findStageRecords(const Stage *stage, const RecordSchema &schema);
+
+// Offset in the file of record index
+uint32_t stageRecordOffset(const StageRecords *records, uint32_t index);
+
+// Index of the record at offset in the file, or -1 if no record of this kind starts there
+// A list read in one go is the count records from here on
+int findStageRecord(const StageRecords *records, uint32_t offset);
+
+// Field values of record index
+uint32_t stageRecordInt(const StageRecords *records, uint32_t index, uint32_t fieldOffset);
+uint16_t stageRecordShort(const StageRecords *records, uint32_t index, uint32_t fieldOffset);
+float stageRecordFloat(const StageRecords *records, uint32_t index, uint32_t fieldOffset);
+
+#pragma region Typed_Records
+
+// Structs laid out like the schemas of the same name, for use with stageRecordArray
+
+#define STAGE_RECORD_TYPE(type, name) static_assert(sizeof(type) == name##Schema.size, #type " doesn't match the " #name " schema")
+
+typedef struct {
+	float position[3];
+	int16_t rotation[4];
+}StageStartPosition;
+STAGE_RECORD_TYPE(StageStartPosition, startPosition);
+
+typedef struct {
+	float position[3];
+	int16_t rotation[3];
+	// Marker, in the file's byte order
+	uint8_t type[2];
+}StageGoal;
+STAGE_RECORD_TYPE(StageGoal, goal);
+
+typedef struct {
+	float position[3];
+	int16_t rotation[4];
+	float scale[3];
+}StageBumper;
+STAGE_RECORD_TYPE(StageBumper, bumper);
+
+typedef StageBumper StageJamabar;
+STAGE_RECORD_TYPE(StageJamabar, jamabar);
+
+typedef struct {
+	float position[3];
+	uint32_t type;
+}StageBanana;
+STAGE_RECORD_TYPE(StageBanana, banana);
+
+typedef struct {
+	float position[3];
+	int16_t rotation[4];
+	float radiusOne;
+	float height;
+	float radiusTwo;
+}StageConeCollision;
+STAGE_RECORD_TYPE(StageConeCollision, coneCollision);
+
+typedef struct {
+	float position[3];
+	float radius;
+	int16_t unknown;
+	int16_t padding;
+}StageSphereCollision;
+STAGE_RECORD_TYPE(StageSphereCollision, sphereCollision);
+
+typedef struct {
+	float position[3];
+	float radius;
+	float height;
+	int16_t rotation[4];
+}StageCylinderCollision;
+STAGE_RECORD_TYPE(StageCylinderCollision, cylinderCollision);
+
+typedef struct {
+	float position[3];
+	float size[3];
+	int16_t rotation[4];
+}StageFalloutVolume;
+STAGE_RECORD_TYPE(StageFalloutVolume, falloutVolume);
+
+typedef struct {
+	float position[3];
+	int16_t rotation[3];
+	uint16_t type;
+	uint16_t animationGroup;
+	uint16_t padding;
+}StageSwitch;
+STAGE_RECORD_TYPE(StageSwitch, switch);
+
+typedef struct {
+	uint32_t easing;
+	float time;
+	float value;
+	uint32_t unknown[2];
+}StageKeyframe;
+STAGE_RECORD_TYPE(StageKeyframe, keyframe);
+
+typedef struct {
+	float position[3];
+	float normal[3];
+	int16_t rotation[4];
+	float distance[4];
+	float tangent[2];
+	float bitangent[2];
+}StageCollisionTriangle;
+STAGE_RECORD_TYPE(StageCollisionTriangle, collisionTriangle);
+
+// Every record of a kind as an array of its struct (ie: stageRecordArray<StageGoal>(findStageRecords(&stage, goalSchema)))
+// Only valid on little endian hosts, use stageRecordInt/Short/Float otherwise
+template <typename T>
+inline const T* stageRecordArray(const StageRecords *records) {
+	if (records == NULL || records->count == 0 || records->schema->size != sizeof(T)) {
+		return NULL;
+	}
+	return reinterpret_cast<const T*>(records->data.data());
+}
+
+#pragma endregion Typed_Records
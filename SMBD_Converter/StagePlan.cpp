@@ -0,0 +1,92 @@
+#include "StagePlan.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <string.h>
+#include <algorithm>
+
+static inline uint64_t stagePlanKey(uint32_t size, int game) {
+	return ((uint64_t)size << 1) | (game == SMBD ? 1 : 0);
+}
+
+static bool samePlanReads(const StagePlan *a, const StagePlan *b) {
+	if (a->reads.size() != b->reads.size() || a->readBytes != b->readBytes) return false;
+	for (size_t i = 0; i < a->reads.size(); ++i) {
+		if (a->reads[i].offset != b->reads[i].offset || a->reads[i].length != b->reads[i].length) return false;
+	}
+	return true;
+}
+
+void clearStagePlanCache(StagePlanCache *cache) {
+	std::lock_guard<std::mutex> guard(cache->lock);
+	cache->plans.clear();
+	cache->order.clear();
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+bool stagePlanMatches(const StagePlan *plan, const uint8_t *input, uint32_t size, int game) {
+	if (plan->size != size || plan->game != game) return false;
+
+	// The bytes are compared rather than hashed, a hash collision would convert the stage wrong
+	// Reads are in file order, so the header is compared first and most other stages stop there
+	const uint8_t *expected = plan->readBytes.data();
+	for (size_t i = 0; i < plan->reads.size(); ++i) {
+		const StageRead *read = &plan->reads[i];
+		if (memcmp(&input[read->offset], expected, read->length) != 0) return false;
+		expected += read->length;
+	}
+	return true;
+}
+
+std::shared_ptr<const StagePlan> findStagePlan(StagePlanCache *cache, const uint8_t *input, uint32_t size, int game) {
+	std::vector<std::shared_ptr<const StagePlan> > candidates;
+	{
+		std::lock_guard<std::mutex> guard(cache->lock);
+		std::map<uint64_t, std::vector<std::shared_ptr<const StagePlan> > >::iterator found = cache->plans.find(stagePlanKey(size, game));
+		if (found != cache->plans.end()) {
+			candidates = found->second;
+		}
+	}
+
+	// Compared without the lock, plans never change once they are added
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (stagePlanMatches(candidates[i].get(), input, size, game)) {
+			std::lock_guard<std::mutex> guard(cache->lock);
+			cache->hits++;
+			return candidates[i];
+		}
+	}
+	std::lock_guard<std::mutex> guard(cache->lock);
+	cache->misses++;
+	return std::shared_ptr<const StagePlan>();
+}
+
+void addStagePlan(StagePlanCache *cache, const std::shared_ptr<const StagePlan> &plan) {
+	std::lock_guard<std::mutex> guard(cache->lock);
+	std::vector<std::shared_ptr<const StagePlan> > &plans = cache->plans[stagePlanKey(plan->size, plan->game)];
+
+	// Stages with the same structure converted at the same time all record it
+	for (size_t i = 0; i < plans.size(); ++i) {
+		if (samePlanReads(plans[i].get(), plan.get())) return;
+	}
+
+	if (plans.size() >= STAGE_PLAN_CACHE_SIZE) {
+		cache->order.remove(plans.front());
+		plans.erase(plans.begin());
+	}
+	plans.push_back(plan);
+	cache->order.push_back(plan);
+
+	if (cache->order.size() > STAGE_PLAN_CACHE_MAX) {
+		std::shared_ptr<const StagePlan> oldest = cache->order.front();
+		cache->order.pop_front();
+		uint64_t key = stagePlanKey(oldest->size, oldest->game);
+		std::vector<std::shared_ptr<const StagePlan> > &oldPlans = cache->plans[key];
+		oldPlans.erase(std::remove(oldPlans.begin(), oldPlans.end(), oldest), oldPlans.end());
+		if (oldPlans.empty()) {
+			cache->plans.erase(key);
+		}
+	}
+}
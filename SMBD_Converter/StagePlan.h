@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "FunctionsAndDefines.h"
+
+// How a raw lz stage is converted, recorded from one walk of it
+// Stages with the same structure (ie: exported the same way) are walked exactly the same, so their conversion is just the recorded spans
+
+// Plans kept per stage size/game
+#define STAGE_PLAN_CACHE_SIZE 4
+// Plans kept in total (the oldest ones are dropped)
+#define STAGE_PLAN_CACHE_MAX 256
+
+// Records of one schema converted from start to end (origin is where they start, before start when the records were cut)
+typedef struct {
+	uint32_t start;
+	uint32_t end;
+	uint32_t origin;
+	const RecordSchema *schema;
+}StageSpan;
+
+// Bytes [offset, offset + length) of a stage
+typedef struct {
+	uint32_t offset;
+	uint32_t length;
+}StageRead;
+
+typedef struct {
+	int game;
+	uint32_t size;
+	// By start, anything between them is zeros
+	std::vector<StageSpan> spans;
+	// Everything the walk read to find the records (pointers, counts, triangle index lists, names)
+	// and the bytes it found there, a stage of the same size with the same bytes there has the same spans
+	std::vector<StageRead> reads;
+	std::vector<uint8_t> readBytes;
+}StagePlan;
+
+// Plans of the stages converted so far (shared by every conversion in a batch)
+typedef struct {
+	std::mutex lock;
+	// By stage size and game
+	std::map<uint64_t, std::vector<std::shared_ptr<const StagePlan> > > plans;
+	// Oldest first
+	std::list<std::shared_ptr<const StagePlan> > order;
+	// Stages converted with a plan from the cache / that had to be walked
+	uint32_t hits;
+	uint32_t misses;
+}StagePlanCache;
+
+void clearStagePlanCache(StagePlanCache *cache);
+
+// True if input (size bytes from game) has the structure plan was recorded from
+bool stagePlanMatches(const StagePlan *plan, const uint8_t *input, uint32_t size, int game);
+
+// Plan of a stage with the same structure as input, NULL if there isn't one
+std::shared_ptr<const StagePlan> findStagePlan(StagePlanCache *cache, const uint8_t *input, uint32_t size, int game);
+
+void addStagePlan(StagePlanCache *cache, const std::shared_ptr<const StagePlan> &plan);
@@ -0,0 +1,464 @@
+#pragma once
+
+#include "FunctionsAndDefines.h"
+
+// Layout of every record in a raw lz stage
+// Offsets/lengths are the same in both games, only the byte order differs
+
+#pragma region File_Header
+
+constexpr FieldSchema stageHeaderFields[] = {
+	INT_FIELDS(0x0, 2),			// Header
+	ITEM_FIELD(0x8),			// Collision Header
+	INT_FIELD(0x10),			// Start positions
+	INT_FIELD(0x14),			// Fallout Y
+	ITEM_FIELD(0x18),			// Goals
+	ITEM_FIELD(0x20),			// Bumpers
+	ITEM_FIELD(0x28),			// Jamabars
+	ITEM_FIELD(0x30),			// Bananas
+	ITEM_FIELD(0x38),			// Cone Collisions
+	ITEM_FIELD(0x40),			// Sphere Collisions
+	ITEM_FIELD(0x48),			// Cylinder Collisions
+	ITEM_FIELD(0x50),			// Fallout Volumes
+	ITEM_FIELD(0x58),			// Background Models
+	ITEM_FIELD(0x60),			// Mystery Eight
+	INT_FIELD(0x68),			// Mystery Twelve
+	INT_FIELD(0x6C),			// One, but not always one
+	ITEM_FIELD(0x70),			// Reflective Models
+	INT_FIELD(0x78),			// Mystery Fourteen
+	INT_FIELDS(0x7C, 2),		// Unknown/Null
+	ITEM_FIELD(0x84),			// Model Duplicates
+	ITEM_FIELD(0x8C),			// Level Model A
+	ITEM_FIELD(0x94),			// Level Model B
+	ITEM_FIELD(0x9C),			// Mystery Fifteen
+	INT_FIELD(0xA4),			// Unknown/Null
+	ITEM_FIELD(0xA8),			// Switches
+	INT_FIELD(0xB0),			// Fog Animation
+	ITEM_FIELD(0xB4),			// Wormholes
+	INT_FIELD(0xBC),			// Fog
+	INT_FIELDS(0xC0, 5),		// Unknown/Null
+	INT_FIELD(0xD4),			// Mystery Three
+	INT_FIELDS(0xD8, 0x1F1)		// Unknown/Null (length = 0x7C4)
+};
+RECORD_SCHEMA(stageHeader, "Stage Header", 0x89C);
+
+#pragma endregion File_Header
+
+#pragma region Collision_Fields
+
+constexpr FieldSchema collisionFieldFields[] = {
+	INT_FIELDS(0x0, 3),			// Center of Rotation (X, Y, Z)
+	SHORT_FIELDS(0xC, 3),		// Initial Rotation (X, Y, Z)
+	SHORT_FIELD(0x12),			// Animation loop type/seesaw
+	INT_FIELD(0x14),			// Animation Offset
+	INT_FIELDS(0x18, 3),		// Conveyor Speed (X, Y, Z)
+	INT_FIELD(0x24),			// Collision Triangle List Offset
+	INT_FIELD(0x28),			// Collision Triangle Grid Offset
+	INT_FIELDS(0x2C, 4),		// Grid Parameters (X Start, Z Start, X Step, Z Step)
+	INT_FIELDS(0x3C, 2),		// Grid Step Counts (X, Z)
+	ITEM_FIELD(0x44),			// Goals
+	ITEM_FIELD(0x4C),			// Bumpers
+	ITEM_FIELD(0x54),			// Jamabars
+	ITEM_FIELD(0x5C),			// Bananas
+	ITEM_FIELD(0x64),			// Cone Collisions
+	ITEM_FIELD(0x6C),			// Sphere Collisions
+	ITEM_FIELD(0x74),			// Cylinder Collisions
+	ITEM_FIELD(0x7C),			// Fallout Volumes
+	ITEM_FIELD(0x84),			// Reflective Models
+	ITEM_FIELD(0x8C),			// Model Duplicates
+	ITEM_FIELD(0x94),			// Level Model Type Bs
+	INT_FIELDS(0x9C, 2),		// Unknown/Null
+	SHORT_FIELDS(0xA4, 2),		// Animation Group ID
+	ITEM_FIELD(0xA8),			// Switches
+	INT_FIELD(0xB0),			// Unknown/Null
+	INT_FIELD(0xB4),			// Mystery Five
+	INT_FIELDS(0xB8, 3),		// Seesaw (Sensitivity, Reset Stiffness, Bounds of Rotation)
+	ITEM_FIELD(0xC4),			// Wormholes
+	INT_FIELD(0xCC),			// Initial Animation State
+	INT_FIELD(0xD0),			// Unknown/Null
+	INT_FIELD(0xD4),			// Animation Loop Point
+	INT_FIELD(0xD8),			// Mystery Eleven
+	INT_FIELDS(0xDC, 0xF0)		// Unknown/Null (length = 0x3C0)
+};
+RECORD_SCHEMA(collisionField, "Collision Field", 0x49C);
+
+constexpr FieldSchema collisionTriangleFields[] = {
+	INT_FIELDS(0x0, 3),			// Position 1 (X, Y, Z)
+	INT_FIELDS(0xC, 3),			// Normal (X, Y, Z)
+	SHORT_FIELDS(0x18, 4),		// Rotation From XY Plane (X, Y, Z, Padding)
+	INT_FIELDS(0x20, 4),		// Distance (DX2X1, DY2Y1, DX3X1, DY3Y1)
+	INT_FIELDS(0x30, 2),		// Tangent (X, Y)
+	INT_FIELDS(0x38, 2)			// Bitangent (X, Y)
+};
+RECORD_SCHEMA(collisionTriangle, "Collision Triangle", 0x40);
+
+// swapCollisionTriangles is hard coded for this layout
+constexpr bool isCollisionTriangleLayout(const RecordSchema &schema, uint32_t offset) {
+	return offset == COLLISION_TRIANGLE_SIZE ? schema.size == COLLISION_TRIANGLE_SIZE :
+		(schemaWidthAt(schema.fields, schema.fieldCount, offset) == ((offset >= 0x18 && offset < 0x20) ? 2u : 4u) && isCollisionTriangleLayout(schema, offset + 1));
+}
+static_assert(isCollisionTriangleLayout(collisionTriangleSchema, 0), "Collision Triangle layout doesn't match swapCollisionTriangles");
+
+#pragma endregion Collision_Fields
+
+#pragma region Animation
+
+// Collision field animation (6 keys)
+constexpr FieldSchema collisionAnimationFields[] = {
+	ITEM_FIELD(0x0),			// Rotation X Keys
+	ITEM_FIELD(0x8),			// Rotation Y Keys
+	ITEM_FIELD(0x10),			// Rotation Z Keys
+	ITEM_FIELD(0x18),			// Translation X Keys
+	ITEM_FIELD(0x20),			// Translation Y Keys
+	ITEM_FIELD(0x28),			// Translation Z Keys
+	INT_FIELDS(0x30, 3),		// Three Floats?
+	SHORT_FIELD(0x3C),			// Unknown/Null
+	SHORT_FIELD(0x3E)			// Some Short
+};
+RECORD_SCHEMA(collisionAnimation, "Collision Animation", 0x40);
+
+// Background model animation one (8 keys)
+constexpr FieldSchema backgroundAnimationOneFields[] = {
+	INT_FIELD(0x0),				// Unknown/Null
+	INT_FIELD(0x4),				// Animation Loop point
+	INT_FIELDS(0x8, 0x10)		// Keys (8 lists)
+};
+RECORD_SCHEMA(backgroundAnimationOne, "Background Animation One", 0x48);
+
+// Background model animation two (11 keys)
+constexpr FieldSchema backgroundAnimationTwoFields[] = {
+	INT_FIELD(0x0),				// Unknown/Null
+	INT_FIELD(0x4),				// Animation Loop point
+	INT_FIELDS(0x8, 0x16)		// Keys (11 lists)
+};
+RECORD_SCHEMA(backgroundAnimationTwo, "Background Animation Two", 0x60);
+
+constexpr FieldSchema fogAnimationFields[] = {
+	INT_FIELDS(0x0, 0xC)		// Keys (6 lists)
+};
+RECORD_SCHEMA(fogAnimation, "Fog Animation", 0x30);
+
+constexpr FieldSchema keyframeFields[] = {
+	INT_FIELD(0x0),				// Easing
+	INT_FIELD(0x4),				// Time
+	INT_FIELD(0x8),				// Value
+	INT_FIELDS(0xC, 2)			// Unknown/Null
+};
+RECORD_SCHEMA(keyframe, "Keyframe", 0x14);
+
+#pragma endregion Animation
+
+#pragma region Effects
+
+constexpr FieldSchema effectsFields[] = {
+	ITEM_FIELD(0x0),			// Effect 1
+	ITEM_FIELD(0x8),			// Effect 2
+	INT_FIELD(0x10),			// Texture Scroll
+	INT_FIELDS(0x14, 7)			// Unknown/Null
+};
+RECORD_SCHEMA(effects, "Effects", 0x30);
+
+constexpr FieldSchema effectOneFields[] = {
+	INT_FIELDS(0x0, 3),			// Unknown (X?, Y?, Z?)
+	SHORT_FIELDS(0xC, 3),		// Unknown (X?, Y?, Z?)
+	MARKER_SHORT(0x12)			// Marker?
+};
+RECORD_SCHEMA(effectOne, "Effect One", 0x14);
+
+constexpr FieldSchema effectTwoFields[] = {
+	INT_FIELDS(0x0, 3),			// Unknown (X?, Y?, Z?)
+	// There is a discrepancy on the size of this (ie: is it 4 bytes or 1 byte then 3 bytes)
+	INT_FIELD(0xC)				// Unknown/Null
+};
+RECORD_SCHEMA(effectTwo, "Effect Two", 0x10);
+
+constexpr FieldSchema textureScrollFields[] = {
+	INT_FIELDS(0x0, 2)			// Speed (X, Y)
+};
+RECORD_SCHEMA(textureScroll, "Texture Scroll", 0x8);
+
+#pragma endregion Effects
+
+#pragma region Stage_Objects
+
+constexpr FieldSchema startPositionFields[] = {
+	INT_FIELDS(0x0, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0xC, 4)		// Rotation (X, Y, Z, Padding/Null)
+};
+RECORD_SCHEMA(startPosition, "Start Position", 0x14);
+
+constexpr FieldSchema falloutYFields[] = {
+	INT_FIELD(0x0)				// Fallout Y
+};
+RECORD_SCHEMA(falloutY, "Fallout Y", 0x4);
+
+constexpr FieldSchema goalFields[] = {
+	INT_FIELDS(0x0, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0xC, 3),		// Rotation (X, Y, Z)
+	MARKER_SHORT(0x12)			// Goal Type
+};
+RECORD_SCHEMA(goal, "Goal", 0x14);
+
+constexpr FieldSchema bumperFields[] = {
+	INT_FIELDS(0x0, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0xC, 4),		// Rotation (X, Y, Z, Padding/Null)
+	INT_FIELDS(0x14, 3)			// Scale (X, Y, Z)
+};
+RECORD_SCHEMA(bumper, "Bumper", 0x20);
+
+constexpr FieldSchema jamabarFields[] = {
+	INT_FIELDS(0x0, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0xC, 4),		// Rotation (X, Y, Z, Padding/Null)
+	INT_FIELDS(0x14, 3)			// Scale (X, Y, Z)
+};
+RECORD_SCHEMA(jamabar, "Jamabar", 0x20);
+
+constexpr FieldSchema bananaFields[] = {
+	INT_FIELDS(0x0, 3),			// Position (X, Y, Z)
+	INT_FIELD(0xC)				// Banana Type
+};
+RECORD_SCHEMA(banana, "Banana", 0x10);
+
+constexpr FieldSchema coneCollisionFields[] = {
+	INT_FIELDS(0x0, 3),			// Base Center Position (X, Y, Z)
+	SHORT_FIELDS(0xC, 4),		// Rotation (X, Y, Z, Padding)
+	INT_FIELD(0x14),			// Radius One
+	INT_FIELD(0x18),			// Height
+	INT_FIELD(0x1C)				// Radius Two
+};
+RECORD_SCHEMA(coneCollision, "Cone Collision", 0x20);
+
+constexpr FieldSchema cylinderCollisionFields[] = {
+	INT_FIELDS(0x0, 3),			// Center Position (X, Y, Z)
+	INT_FIELD(0xC),				// Radius
+	INT_FIELD(0x10),			// Height
+	SHORT_FIELDS(0x14, 4)		// Rotation (X, Y, Z, Padding)
+};
+RECORD_SCHEMA(cylinderCollision, "Cylinder Collision", 0x1C);
+
+constexpr FieldSchema sphereCollisionFields[] = {
+	INT_FIELDS(0x0, 3),			// Center Position (X, Y, Z)
+	INT_FIELD(0xC),				// Radius
+	SHORT_FIELD(0x10),			// Short
+	SHORT_FIELD(0x12)			// Padding?
+};
+RECORD_SCHEMA(sphereCollision, "Sphere Collision", 0x14);
+
+constexpr FieldSchema falloutVolumeFields[] = {
+	INT_FIELDS(0x0, 3),			// Center Position (X, Y, Z)
+	INT_FIELDS(0xC, 3),			// Size (X, Y, Z)
+	SHORT_FIELDS(0x18, 4)		// Rotation (X, Y, Z, Padding/Null)
+};
+RECORD_SCHEMA(falloutVolume, "Fallout Volume", 0x20);
+
+constexpr FieldSchema switchFields[] = {
+	INT_FIELDS(0x0, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0xC, 3),		// Rotation (X, Y, Z)
+	SHORT_FIELD(0x12),			// Switch type
+	SHORT_FIELD(0x14),			// Animation Group IDs affected
+	SHORT_FIELD(0x16)			// Padding/Null
+};
+RECORD_SCHEMA(switch, "Switch", 0x18);
+
+// Every second wormhole has its ID as a marker (no endianness change), so they are converted in pairs
+constexpr FieldSchema wormholeFields[] = {
+	INT_FIELD(0x0),				// Wormhole ID (1)
+	INT_FIELDS(0x4, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0x10, 4),		// Rotation (X, Y, Z, Padding/Null)
+	INT_FIELD(0x18)				// Offset to destination wormwhole
+};
+RECORD_SCHEMA(wormhole, "Wormhole", 0x1C);
+
+constexpr FieldSchema wormholePairFields[] = {
+	INT_FIELD(0x0),				// Wormhole ID (1)
+	INT_FIELDS(0x4, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0x10, 4),		// Rotation (X, Y, Z, Padding/Null)
+	INT_FIELD(0x18),			// Offset to destination wormwhole
+	MARKER_INT(0x1C),			// Second Wormhole ID (marker)
+	INT_FIELDS(0x20, 3),		// Position (X, Y, Z)
+	SHORT_FIELDS(0x2C, 4),		// Rotation (X, Y, Z, Padding/Null)
+	INT_FIELD(0x34)				// Offset to destination wormwhole
+};
+RECORD_SCHEMA(wormholePair, "Wormhole Pair", 0x38);
+
+constexpr FieldSchema fogFields[] = {
+	MARKER_INT(0x0),			// Fog Id Marker
+	MARKER_INTS(0x4, 2),		// Distance (Start, End)
+	MARKER_INTS(0xC, 3),		// Color (Red, Green, Blue)
+	INT_FIELDS(0x18, 3)			// Unknown/Null
+};
+RECORD_SCHEMA(fog, "Fog", 0x24);
+
+#pragma endregion Stage_Objects
+
+#pragma region Models
+
+constexpr FieldSchema backgroundModelFields[] = {
+	INT_FIELD(0x0),				// Background Model Symbol
+	INT_FIELD(0x4),				// Model Name Offset
+	INT_FIELD(0x8),				// Null/Padding
+	INT_FIELDS(0xC, 3),			// Position (X, Y, Z)
+	SHORT_FIELDS(0x18, 4),		// Rotation (X, Y, Z, Padding)
+	INT_FIELDS(0x20, 3),		// Scale (X, Y, Z)
+	INT_FIELD(0x2C),			// Animation One
+	INT_FIELD(0x30),			// Animation Two
+	INT_FIELD(0x34)				// Effects
+};
+RECORD_SCHEMA(backgroundModel, "Background Model", 0x38);
+
+constexpr FieldSchema reflectiveModelFields[] = {
+	INT_FIELD(0x0),				// Model Name offset
+	INT_FIELDS(0x4, 2)			// Null/Padding
+};
+RECORD_SCHEMA(reflectiveModel, "Reflective Model", 0xC);
+
+constexpr FieldSchema modelDuplicateFields[] = {
+	INT_FIELD(0x0),				// Offset to level model A
+	INT_FIELDS(0x4, 3),			// Position? (X?, Y?, Z?)
+	SHORT_FIELDS(0x10, 4),		// Rotation?? (Unknown X?, Has Value Y, Unknown Z?, Unknown Padding?)
+	INT_FIELDS(0x18, 3)			// Scale?
+};
+RECORD_SCHEMA(modelDuplicate, "Model Duplicate", 0x24);
+
+constexpr FieldSchema levelModelAFields[] = {
+	INT_FIELDS(0x0, 2),			// Level Model A Symbol
+	INT_FIELD(0x8)				// Offset to Level Model A (Actual)
+};
+RECORD_SCHEMA(levelModelA, "Level Model A", 0xC);
+
+constexpr FieldSchema levelModelAActualFields[] = {
+	INT_FIELD(0x0),				// Null
+	INT_FIELD(0x4),				// Model Name offset
+	INT_FIELD(0x8),				// Null/Padding
+	INT_FIELD(0xC)				// Float (Sometimes 0x41F00000)
+};
+RECORD_SCHEMA(levelModelAActual, "Level Model A (Actual)", 0x10);
+
+constexpr FieldSchema levelModelBFields[] = {
+	INT_FIELD(0x0)				// Offset to Level Model A
+};
+RECORD_SCHEMA(levelModelB, "Level Model B", 0x4);
+
+#pragma endregion Models
+
+#pragma region Mystery
+
+constexpr FieldSchema mysteryThreeFields[] = {
+	INT_FIELDS(0x0, 3),			// Position?
+	SHORT_FIELD(0xC),			// Unknown/Null
+	SHORT_FIELD(0xE),			// The marker value
+	INT_FIELDS(0x10, 5)			// Unknown/Null
+};
+RECORD_SCHEMA(mysteryThree, "Mystery Three", 0x24);
+
+constexpr FieldSchema mysteryFiveFields[] = {
+	INT_FIELD(0x0),				// Unknown/Null
+	INT_FIELDS(0x4, 3)			// Unknown/Floats
+};
+RECORD_SCHEMA(mysteryFive, "Mystery Five", 0x10);
+
+constexpr FieldSchema mysteryEightFields[] = {
+	INT_FIELD(0x0),				// Marker (0x1F)
+	INT_FIELD(0x4),				// Model Name Offset
+	INT_FIELD(0x8),				// Unknown/Null
+	INT_FIELDS(0xC, 3),			// Position? (X?, Y?, Z?)
+	SHORT_FIELDS(0x18, 4),		// Rotation? (X, Y, Z, Padding; generally null but Y)
+	INT_FIELDS(0x20, 3),		// Three floats (Generally the same value and small (ie .5))
+	INT_FIELDS(0x2C, 3)			// Unknown/Null
+};
+RECORD_SCHEMA(mysteryEight, "Mystery Eight", 0x38);
+
+constexpr FieldSchema mysteryElevenFields[] = {
+	INT_FIELD(0x0),				// Float?
+	INT_FIELD(0x4)				// Unknown/Null
+};
+RECORD_SCHEMA(mysteryEleven, "Mystery Eleven", 0x8);
+
+constexpr FieldSchema mysteryTwelveFields[] = {
+	ITEM_FIELD(0x0),			// Set 1
+	ITEM_FIELD(0x8),			// Set 2
+	ITEM_FIELD(0x10),			// Set 3
+	ITEM_FIELD(0x18),			// Set 4
+	ITEM_FIELD(0x20),			// Set 5
+	INT_FIELDS(0x28, 0x32)		// Unknown/Null (length = 0xC8)
+};
+RECORD_SCHEMA(mysteryTwelve, "Mystery Twelve", 0xF0);
+
+// Sets 1-3 and the inner sets of set 4
+constexpr FieldSchema mysteryTwelveEntryFields[] = {
+	INT_FIELD(0x0),				// One
+	INT_FIELDS(0x4, 4)			// Floats (Set 2: Incrementing Index then Unknown/Null)
+};
+RECORD_SCHEMA(mysteryTwelveEntry, "Mystery Twelve Entry", 0x14);
+
+constexpr FieldSchema mysteryTwelveSetFourFields[] = {
+	ITEM_FIELD(0x0),			// Inner Set 1
+	ITEM_FIELD(0x8),			// Inner Set 2
+	ITEM_FIELD(0x10)			// Inner Set 3
+};
+RECORD_SCHEMA(mysteryTwelveSetFour, "Mystery Twelve Set 4", 0x18);
+
+constexpr FieldSchema mysteryTwelveSetFiveFields[] = {
+	INT_FIELDS(0x0, 3),			// Three Floats
+	SHORT_FIELDS(0xC, 4)		// Four Shorts?
+};
+RECORD_SCHEMA(mysteryTwelveSetFive, "Mystery Twelve Set 5", 0x14);
+
+constexpr FieldSchema mysteryFourteenFields[] = {
+	INT_FIELDS(0x0, 3),			// Three floats?
+	INT_FIELDS(0xC, 2),			// Two Floats (use lower 2 bytes only?)?
+	INT_FIELDS(0x14, 0x40)		// Unknown/Null (0x40 ints)
+};
+RECORD_SCHEMA(mysteryFourteen, "Mystery Fourteen", 0x114);
+
+#pragma endregion Mystery
+
+#pragma region Plain_Values
+
+// Data that isn't a record (grid cell pointers, triangle index lists, names)
+// Used to describe what a region of the stage was converted as
+
+constexpr FieldSchema gridPointerFields[] = {
+	INT_FIELD(0x0)				// Triangle index list offset
+};
+RECORD_SCHEMA(gridPointer, "Collision Grid Pointer", 0x4);
+
+constexpr FieldSchema triangleIndexFields[] = {
+	SHORT_FIELD(0x0)			// Collision triangle index (0xFFFF ends a list)
+};
+RECORD_SCHEMA(triangleIndex, "Collision Triangle Index", 0x2);
+
+constexpr FieldSchema asciiFields[] = {
+	MARKER_BYTE(0x0)			// Character (copied as is)
+};
+RECORD_SCHEMA(ascii, "Name", 0x1);
+
+#pragma endregion Plain_Values
+
+#pragma region Schema_List
+
+// Every schema above (ie: to look one up by name when reading a saved stage graph)
+constexpr const RecordSchema* stageSchemas[] = {
+	&stageHeaderSchema, &collisionFieldSchema, &collisionTriangleSchema, &collisionAnimationSchema,
+	&backgroundAnimationOneSchema, &backgroundAnimationTwoSchema, &fogAnimationSchema, &keyframeSchema,
+	&effectsSchema, &effectOneSchema, &effectTwoSchema, &textureScrollSchema, &startPositionSchema,
+	&falloutYSchema, &goalSchema, &bumperSchema, &jamabarSchema, &bananaSchema, &coneCollisionSchema,
+	&cylinderCollisionSchema, &sphereCollisionSchema, &falloutVolumeSchema, &switchSchema, &wormholeSchema,
+	&wormholePairSchema, &fogSchema, &backgroundModelSchema, &reflectiveModelSchema, &modelDuplicateSchema,
+	&levelModelASchema, &levelModelAActualSchema, &levelModelBSchema, &mysteryThreeSchema, &mysteryFiveSchema,
+	&mysteryEightSchema, &mysteryElevenSchema, &mysteryTwelveSchema, &mysteryTwelveEntrySchema,
+	&mysteryTwelveSetFourSchema, &mysteryTwelveSetFiveSchema, &mysteryFourteenSchema, &gridPointerSchema,
+	&triangleIndexSchema, &asciiSchema
+};
+
+// Schema named name (this source file's copy), NULL if there is none
+static inline const RecordSchema* findStageSchema(const char *name) {
+	for (size_t i = 0; i < sizeof(stageSchemas) / sizeof(stageSchemas[0]); ++i) {
+		if (strcmp(stageSchemas[i]->name, name) == 0) {
+			return stageSchemas[i];
+		}
+	}
+	return NULL;
+}
+
+#pragma endregion Schema_List
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "FunctionsAndDefines.h"
+#include "StageSchemas.h"
+
+// Read only views of a raw lz laid straight over its bytes (ie: a mapped file), nothing is converted or copied
+// Every value is decoded when it's read, so looking at a few fields of many stages only touches those bytes
+//
+// Views are templated on the byte order of the file:
+//   const StageHeaderView<BigEndian> *header = viewStageHeader<BigEndian>(&image);	// SMB2
+//   const StageHeaderView<LittleEndian> *header = viewStageHeader<LittleEndian>(&image);	// SMBD
+//   ViewList<GoalView<BigEndian> > goals = viewList<GoalView<BigEndian> >(&image, header->goals);
+//   float x = goals[0].position[0];
+
+#pragma region Endian_Values
+
+template <typename T, typename Format, size_t size = sizeof(T)>
+struct EndianDecoder;
+
+template <typename T, typename Format>
+struct EndianDecoder<T, Format, 4> {
+	static inline T decode(const uint8_t *bytes) {
+		uint32_t bits = Format::readInt(bytes);
+		T value;
+		memcpy(&value, &bits, 4);
+		return value;
+	}
+};
+
+template <typename T, typename Format>
+struct EndianDecoder<T, Format, 2> {
+	static inline T decode(const uint8_t *bytes) {
+		uint16_t bits = Format::readShort(bytes);
+		T value;
+		memcpy(&value, &bits, 2);
+		return value;
+	}
+};
+
+// A value stored in Format's byte order (unaligned is fine)
+template <typename T, typename Format>
+struct EndianValue {
+	uint8_t bytes[sizeof(T)];
+
+	inline T get() const { return EndianDecoder<T, Format>::decode(bytes); }
+	inline operator T() const { return get(); }
+};
+
+template <typename T>
+using BigEndian = EndianValue<T, SMB2Format>;
+
+template <typename T>
+using LittleEndian = EndianValue<T, SMBDFormat>;
+
+#pragma endregion Endian_Values
+
+#pragma region Stage_Image
+
+// Raw lz bytes in memory
+typedef struct {
+	const uint8_t *data;
+	uint32_t size;
+}StageImage;
+
+// Back to back records inside the file
+template <typename T>
+struct ViewList {
+	const T *records;
+	// Only the records that are entirely inside the file
+	uint32_t count;
+
+	inline const T& operator[](uint32_t index) const { return records[index]; }
+	inline const T* begin() const { return records; }
+	inline const T* end() const { return records + count; }
+};
+
+// Count and offset of a list
+template <template <typename> class E>
+struct ItemView {
+	E<int32_t> number;
+	E<uint32_t> offset;
+};
+
+// Same check convertRawLZ uses (SMBD has 0 in the high byte of the second header int)
+inline bool isSMBDImage(const StageImage *image) {
+	return image->size >= 0x89C && image->data[4] == 0;
+}
+
+// The record at offset, or NULL if offset is null or the record doesn't fit in the file
+template <typename T>
+inline const T* viewRecord(const StageImage *image, uint32_t offset) {
+	if (offset == 0 || offset >= image->size || image->size - offset < sizeof(T)) {
+		return NULL;
+	}
+	return reinterpret_cast<const T*>(&image->data[offset]);
+}
+
+// A list, cut off at the end of the file (empty if its offset is null)
+template <typename T>
+inline ViewList<T> viewList(const StageImage *image, uint32_t offset, int32_t number) {
+	ViewList<T> list = { NULL, 0 };
+	if (offset == 0 || number <= 0 || offset >= image->size) {
+		return list;
+	}
+	uint32_t available = (image->size - offset) / sizeof(T);
+	list.records = reinterpret_cast<const T*>(&image->data[offset]);
+	list.count = (uint32_t)number < available ? (uint32_t)number : available;
+	return list;
+}
+
+template <typename T, template <typename> class E>
+inline ViewList<T> viewList(const StageImage *image, const ItemView<E> &item) {
+	return viewList<T>(image, item.offset, item.number);
+}
+
+#pragma endregion Stage_Image
+
+#pragma region Views
+
+// Same layouts as the schemas in StageSchemas.h
+
+template <template <typename> class E>
+struct StageHeaderView {
+	E<uint32_t> header[2];				// 0x0
+	ItemView<E> collisionFields;		// 0x8
+	E<uint32_t> startPositions;			// 0x10
+	E<uint32_t> falloutY;				// 0x14
+	ItemView<E> goals;					// 0x18
+	ItemView<E> bumpers;				// 0x20
+	ItemView<E> jamabars;				// 0x28
+	ItemView<E> bananas;				// 0x30
+	ItemView<E> coneCollisions;			// 0x38
+	ItemView<E> sphereCollisions;		// 0x40
+	ItemView<E> cylinderCollisions;		// 0x48
+	ItemView<E> falloutVolumes;			// 0x50
+	ItemView<E> backgroundModels;		// 0x58
+	ItemView<E> mysteryEight;			// 0x60
+	E<uint32_t> mysteryTwelve;			// 0x68
+	E<uint32_t> one;					// 0x6C
+	ItemView<E> reflectiveModels;		// 0x70
+	E<uint32_t> mysteryFourteen;		// 0x78
+	E<uint32_t> unknown0[2];			// 0x7C
+	ItemView<E> modelDuplicates;		// 0x84
+	ItemView<E> levelModelA;			// 0x8C
+	ItemView<E> levelModelB;			// 0x94
+	ItemView<E> mysteryFifteen;			// 0x9C
+	E<uint32_t> unknown1;				// 0xA4
+	ItemView<E> switches;				// 0xA8
+	E<uint32_t> fogAnimation;			// 0xB0
+	ItemView<E> wormholes;				// 0xB4
+	E<uint32_t> fog;					// 0xBC
+	E<uint32_t> unknown2[5];			// 0xC0
+	E<uint32_t> mysteryThree;			// 0xD4
+	E<uint32_t> unknown3[0x1F1];		// 0xD8
+};
+
+template <template <typename> class E>
+struct CollisionFieldView {
+	E<float> center[3];					// 0x0
+	E<int16_t> rotation[3];				// 0xC
+	E<uint16_t> animationLoopType;		// 0x12
+	E<uint32_t> animation;				// 0x14
+	E<float> conveyorSpeed[3];			// 0x18
+	E<uint32_t> triangles;				// 0x24
+	E<uint32_t> grid;					// 0x28
+	E<float> gridStart[2];				// 0x2C (X, Z)
+	E<float> gridStep[2];				// 0x34 (X, Z)
+	E<uint32_t> gridStepCount[2];		// 0x3C (X, Z)
+	ItemView<E> goals;					// 0x44
+	ItemView<E> bumpers;				// 0x4C
+	ItemView<E> jamabars;				// 0x54
+	ItemView<E> bananas;				// 0x5C
+	ItemView<E> coneCollisions;			// 0x64
+	ItemView<E> sphereCollisions;		// 0x6C
+	ItemView<E> cylinderCollisions;		// 0x74
+	ItemView<E> falloutVolumes;			// 0x7C
+	ItemView<E> reflectiveModels;		// 0x84
+	ItemView<E> modelDuplicates;		// 0x8C
+	ItemView<E> levelModelB;			// 0x94
+	E<uint32_t> unknown0[2];			// 0x9C
+	E<uint16_t> animationGroup[2];		// 0xA4
+	ItemView<E> switches;				// 0xA8
+	E<uint32_t> unknown1;				// 0xB0
+	E<uint32_t> mysteryFive;			// 0xB4
+	E<float> seesaw[3];					// 0xB8 (Sensitivity, Reset Stiffness, Bounds of Rotation)
+	ItemView<E> wormholes;				// 0xC4
+	E<uint32_t> initialAnimationState;	// 0xCC
+	E<uint32_t> unknown2;				// 0xD0
+	E<float> animationLoopPoint;		// 0xD4
+	E<uint32_t> mysteryEleven;			// 0xD8
+	E<uint32_t> unknown3[0xF0];			// 0xDC
+};
+
+template <template <typename> class E>
+struct CollisionTriangleView {
+	E<float> position[3];
+	E<float> normal[3];
+	E<int16_t> rotation[4];
+	E<float> distance[4];
+	E<float> tangent[2];
+	E<float> bitangent[2];
+};
+
+template <template <typename> class E>
+struct CollisionAnimationView {
+	ItemView<E> keys[6];				// Rotation X/Y/Z, Translation X/Y/Z
+	E<float> unknown0[3];
+	E<uint16_t> unknown1;
+	E<uint16_t> unknown2;
+};
+
+template <template <typename> class E>
+struct KeyframeView {
+	E<uint32_t> easing;
+	E<float> time;
+	E<float> value;
+	E<uint32_t> unknown[2];
+};
+
+template <template <typename> class E>
+struct StartPositionView {
+	E<float> position[3];
+	E<int16_t> rotation[4];
+};
+
+template <template <typename> class E>
+struct GoalView {
+	E<float> position[3];
+	E<int16_t> rotation[3];
+	// Marker (same bytes in both games)
+	uint8_t type[2];
+};
+
+template <template <typename> class E>
+struct BumperView {
+	E<float> position[3];
+	E<int16_t> rotation[4];
+	E<float> scale[3];
+};
+
+template <template <typename> class E>
+using JamabarView = BumperView<E>;
+
+template <template <typename> class E>
+struct BananaView {
+	E<float> position[3];
+	E<uint32_t> type;
+};
+
+template <template <typename> class E>
+struct ConeCollisionView {
+	E<float> position[3];
+	E<int16_t> rotation[4];
+	E<float> radiusOne;
+	E<float> height;
+	E<float> radiusTwo;
+};
+
+template <template <typename> class E>
+struct SphereCollisionView {
+	E<float> position[3];
+	E<float> radius;
+	E<int16_t> unknown;
+	E<int16_t> padding;
+};
+
+template <template <typename> class E>
+struct CylinderCollisionView {
+	E<float> position[3];
+	E<float> radius;
+	E<float> height;
+	E<int16_t> rotation[4];
+};
+
+template <template <typename> class E>
+struct FalloutVolumeView {
+	E<float> position[3];
+	E<float> size[3];
+	E<int16_t> rotation[4];
+};
+
+template <template <typename> class E>
+struct SwitchView {
+	E<float> position[3];
+	E<int16_t> rotation[3];
+	E<uint16_t> type;
+	E<uint16_t> animationGroup;
+	E<uint16_t> padding;
+};
+
+// Every second wormhole's ID is a marker, read it from the bytes if it matters
+template <template <typename> class E>
+struct WormholeView {
+	E<uint32_t> id;
+	E<float> position[3];
+	E<int16_t> rotation[4];
+	E<uint32_t> destination;
+};
+
+template <template <typename> class E>
+struct BackgroundModelView {
+	E<uint32_t> symbol;
+	E<uint32_t> name;
+	E<uint32_t> padding;
+	E<float> position[3];
+	E<int16_t> rotation[4];
+	E<float> scale[3];
+	E<uint32_t> animationOne;
+	E<uint32_t> animationTwo;
+	E<uint32_t> effects;
+};
+
+template <template <typename> class E>
+struct ReflectiveModelView {
+	E<uint32_t> name;
+	E<uint32_t> padding[2];
+};
+
+template <template <typename> class E>
+struct LevelModelAView {
+	E<uint32_t> symbol[2];
+	E<uint32_t> model;
+};
+
+template <template <typename> class E>
+struct LevelModelAActualView {
+	E<uint32_t> null;
+	E<uint32_t> name;
+	E<uint32_t> padding;
+	E<float> unknown;
+};
+
+// Every view has to be laid out exactly like its schema
+#define STAGE_VIEW(view, name) \
+	static_assert(sizeof(view<BigEndian>) == name##Schema.size && sizeof(view<LittleEndian>) == name##Schema.size, #view " doesn't match the " #name " schema")
+
+STAGE_VIEW(StageHeaderView, stageHeader);
+STAGE_VIEW(CollisionFieldView, collisionField);
+STAGE_VIEW(CollisionTriangleView, collisionTriangle);
+STAGE_VIEW(CollisionAnimationView, collisionAnimation);
+STAGE_VIEW(KeyframeView, keyframe);
+STAGE_VIEW(StartPositionView, startPosition);
+STAGE_VIEW(GoalView, goal);
+STAGE_VIEW(BumperView, bumper);
+STAGE_VIEW(JamabarView, jamabar);
+STAGE_VIEW(BananaView, banana);
+STAGE_VIEW(ConeCollisionView, coneCollision);
+STAGE_VIEW(SphereCollisionView, sphereCollision);
+STAGE_VIEW(CylinderCollisionView, cylinderCollision);
+STAGE_VIEW(FalloutVolumeView, falloutVolume);
+STAGE_VIEW(SwitchView, switch);
+STAGE_VIEW(WormholeView, wormhole);
+STAGE_VIEW(BackgroundModelView, backgroundModel);
+STAGE_VIEW(ReflectiveModelView, reflectiveModel);
+STAGE_VIEW(LevelModelAView, levelModelA);
+STAGE_VIEW(LevelModelAActualView, levelModelAActual);
+
+static_assert(offsetof(StageHeaderView<BigEndian>, goals) == 0x18 && offsetof(StageHeaderView<BigEndian>, mysteryThree) == 0xD4, "Stage header view offsets are off");
+static_assert(offsetof(CollisionFieldView<BigEndian>, grid) == 0x28 && offsetof(CollisionFieldView<BigEndian>, wormholes) == 0xC4, "Collision field view offsets are off");
+
+#pragma endregion Views
+
+// The stage header, or NULL if the file is too small to be a stage
+template <template <typename> class E>
+inline const StageHeaderView<E>* viewStageHeader(const StageImage *image) {
+	if (image->size < sizeof(StageHeaderView<E>)) {
+		return NULL;
+	}
+	return reinterpret_cast<const StageHeaderView<E>*>(image->data);
+}
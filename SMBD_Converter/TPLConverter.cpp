@@ -19,139 +19,115 @@ typedef struct {
 	uint16_t always1234;
 }Texture;
 
-void copyTexture(FILE* input, FILE* output, uint32_t offset, uint32_t encoding);
-
-void copyCompressedTexture(FILE* input, FILE* output, uint32_t offset, uint32_t encoding);
+template <typename From, typename To>
+static void convertTextures(ConversionContext *context, InputStream *original, OutputStream *converted);
 
 void parseTPL(char* filename) {
-	int game = 0;
-
-	// Using function pointers to read/write values keeps things game agnostic (can convert from SMBD to SMB2 or SMB2 to SMBD)
-	uint32_t(*readInt)(FILE*);
-	void(*writeInt)(FILE*, uint32_t);
-	void(*writeNormalInt)(FILE*, uint32_t);
-
-	uint16_t(*readShort)(FILE*);
-	void(*writeShort)(FILE*, uint16_t);
-	void(*writeNormalShort)(FILE*, uint16_t);
-
-	std::string outfilename = std::string(filename);
-
-	FILE *original = fopen(filename, "rb");
-	FILE* converted;
-
-	std::string inputFile(filename);
+	ConversionContext context;
+	initConversionContext(&context, filename);
 
-	std::string outputFile;
-
-	Texture textures[256];
-
-	if (original == NULL) {
-		printf("Error opening file\n");
-		return;
+	if (loadInputFile(&context) && convertTPL(&context) == 0) {
+		writeOutputFile(&context, convertedFilename(&context), context.output.data(), context.output.size());
 	}
+	printDiagnostics(&context);
+}
 
-	uint32_t fileLength;
-	fseek(original, 0, SEEK_END);
-	fileLength = ftell(original);
-	fseek(original, 0, SEEK_SET);
+int convertTPL(ConversionContext *context) {
+	adviseInputSource(&context->input, INPUT_ACCESS_SEQUENTIAL);
+	InputStream original = { context->input.data, context->input.size, 0 };
+	context->output.clear();
+	OutputStream converted = { &context->output, 0 };
 
 	// Check which game it is (SMBD starts with the ascii "XTPL")
-	if (getc(original) == 'X' && getc(original) == 'T' && getc(original) == 'P' && getc(original) == 'L') {
-		game = SMBD;
-		outputFile = inputFile + ".smb2";
-		// Open the output file
-		converted = fopen(outputFile.c_str(), "wb");
-
-		// Set correct IO functions
-		readInt = &readLittleInt;
-		readShort = &readLittleShort;
-
-		writeInt = &writeBigInt;
-		writeShort = &writeBigShort;
+	if (context->sourceGame == GAME_UNKNOWN) {
+		bool xtpl = readByte(&original) == 'X' && readByte(&original) == 'T' && readByte(&original) == 'P' && readByte(&original) == 'L';
+		context->sourceGame = xtpl ? SMBD : SMB2;
+	}
+	original.position = context->sourceGame == SMBD ? 4 : 0;
 
-		writeNormalInt = &writeLittleInt;
-		writeNormalShort = &writeLittleShort;
+	if (context->sourceGame == SMBD) {
+		context->targetGame = SMB2;
+		convertTextures<SMBDFormat, SMB2Format>(context, &original, &converted);
 	}
 	else {
-		game = SMB2;
-		fseek(original, 0, SEEK_SET);
-		outputFile = inputFile + ".smbd";
-		// Open the output file
-		converted = fopen(outputFile.c_str(), "wb");
+		context->targetGame = SMBD;
 		// Initial header
-		putc('X', converted);
-		putc('T', converted);
-		putc('P', converted);
-		putc('L', converted);
-
-		// Set correct IO functions
-		readInt = &readBigInt;
-		readShort = &readBigShort;
+		writeByte(&converted, 'X');
+		writeByte(&converted, 'T');
+		writeByte(&converted, 'P');
+		writeByte(&converted, 'L');
 
-		writeInt = &writeLittleInt;
-		writeShort = &writeLittleShort;
-
-		writeNormalInt = &writeBigInt;
-		writeNormalShort = &writeBigShort;
+		convertTextures<SMB2Format, SMBDFormat>(context, &original, &converted);
 	}
+	return hasErrors(context) ? -1 : 0;
+}
 
-	
+template <typename From, typename To>
+static void convertTextures(ConversionContext *context, InputStream *original, OutputStream *converted) {
+	const int game = From::game;
+	const uint32_t fileLength = (uint32_t)original->size;
+
+	Texture textures[256];
 
 	// Get num textures
-	int numTextures = readInt(original);
+	int numTextures = From::readInt(original);
 	int deadTextures = 0;
 	// Write num textures later
-	fseek(converted, 4, SEEK_CUR);
+	converted->position += 4;
 
 	if (numTextures > 256) {
+		addDiagnostic(context, DIAGNOSTIC_WARNING, "%s: Number of textures truncated to 256", context->filename.c_str());
 		numTextures = 256;
-		printf("Number of textures truncated to 256\n");
+	}
+	if (numTextures < 0) {
+		numTextures = 0;
 	}
 
 	// Read in texture headers (we will write the the textre headers once we know the new offsets)
 	for (int i = 0; i < numTextures; ++i) {
 		// Encoding
-		textures[i].encoding = readInt(original);
+		textures[i].encoding = From::readInt(original);
 
 		// Offset to data
-		textures[i].originalOffset = readInt(original);
+		textures[i].originalOffset = From::readInt(original);
 
 		// Width
-		textures[i].width = readShort(original);
+		textures[i].width = From::readShort(original);
 
 		// Height
-		textures[i].height = readShort(original);
+		textures[i].height = From::readShort(original);
 
 		// Level Count (mip maps)
-		textures[i].unknown = readShort(original);
+		textures[i].unknown = From::readShort(original);
 
 		// Always 0x1234?
-		textures[i].always1234 = readShort(original);
+		textures[i].always1234 = From::readShort(original);
 	}
 
 	// Sekip past the texture headers in the converted file
-	fseek(converted, numTextures * 0x10, SEEK_CUR);
+	converted->position += numTextures * 0x10;
 
-	int difference = textures[0].originalOffset - ftell(converted);
-	for (int i = 0; i < difference; ++i) {
-		putc(0, converted);
+	if (numTextures > 0) {
+		int difference = textures[0].originalOffset - (int)converted->position;
+		for (int i = 0; i < difference; ++i) {
+			writeByte(converted, 0);
+		}
 	}
 
 	// Copy the texture data
 	for (int i = 0; i < numTextures; ++i) {
 		// Seek to the texture
-		fseek(original, textures[i].originalOffset, SEEK_SET);
-		textures[i].convertedOffset = ftell(converted);
+		original->position = textures[i].originalOffset;
+		textures[i].convertedOffset = (uint32_t)converted->position;
 
 		if (game == SMB2) {
 			if (textures[i].encoding == CMPR) {
 				// Secondary CMPR Marker
-				writeNormalInt(converted, 0x0C000000);
+				From::writeInt(converted, 0x0C000000);
 				
 			}
 			else if (textures[i].encoding == I8) {
-				writeNormalInt(converted, 0x1A000000);
+				From::writeInt(converted, 0x1A000000);
 			}
 			else {
 				++deadTextures;
@@ -159,20 +135,20 @@ void parseTPL(char* filename) {
 			}
 
 			// Width
-			writeShort(converted, textures[i].width);
+			To::writeShort(converted, textures[i].width);
 			// Padding
-			writeShort(converted, 0);
+			To::writeShort(converted, 0);
 
 			// Height
-			writeShort(converted, textures[i].height);
+			To::writeShort(converted, textures[i].height);
 			// Padding
-			writeShort(converted, 0);
+			To::writeShort(converted, 0);
 
 			// 4 or 5 ?
-			writeInt(converted, 5);
+			To::writeInt(converted, 5);
 
 			// Is it compressed (0x10000000 = compressed, 0x00000000 = uncompressed)
-			writeInt(converted, 0);
+			To::writeInt(converted, 0);
 
 			// Length of data
 			uint32_t dataLength;
@@ -183,52 +159,54 @@ void parseTPL(char* filename) {
 			else {
 				dataLength = fileLength - textures[i].originalOffset;
 			}
-			writeInt(converted, dataLength);
+			To::writeInt(converted, dataLength);
 
 			// Length of data + 0xD (with part of header?), 0 if uncompressed
-			writeInt(converted, 0);
+			To::writeInt(converted, 0);
 
 			// Zero/Padding?
-			writeInt(converted, 0);
+			To::writeInt(converted, 0);
 
-			// Data
+			// Data (stops at the end of the file)
+			if (textures[i].originalOffset > fileLength || dataLength > fileLength - textures[i].originalOffset) {
+				addDiagnostic(context, DIAGNOSTIC_WARNING, "%s: Texture %d data runs past the end of the file", context->filename.c_str(), i);
+				dataLength = textures[i].originalOffset < fileLength ? fileLength - textures[i].originalOffset : 0;
+			}
 			for (int j = 0; j < (int) dataLength; ++j) {
-				putc(getc(original), converted);
+				writeByte(converted, readByte(original));
 			}
 		}
 	}
 
-	fclose(original);
 	if (game == SMBD) {
-		fseek(converted, 0, SEEK_SET);
+		converted->position = 0;
 	}
 	else if (game == SMB2) {
-		fseek(converted, 4, SEEK_SET);
+		converted->position = 4;
 	}
 
-	writeInt(converted, numTextures - deadTextures);
+	To::writeInt(converted, numTextures - deadTextures);
 
 	for (int i = 0; i < numTextures; ++i) {
 		if (textures[i].encoding != CMPR && textures[i].encoding != I8) {
 			continue;
 		}
 		// Encoding
-		writeInt(converted, textures[i].encoding);
+		To::writeInt(converted, textures[i].encoding);
 
 		// Data Offset
-		writeInt(converted, textures[i].convertedOffset);
+		To::writeInt(converted, textures[i].convertedOffset);
 
 		// Width
-		writeShort(converted, textures[i].width);
+		To::writeShort(converted, textures[i].width);
 
 		// Height
-		writeShort(converted, textures[i].height);
+		To::writeShort(converted, textures[i].height);
 
 		// Unknown
-		writeShort(converted, textures[i].unknown);
+		To::writeShort(converted, textures[i].unknown);
 
 		// 0x1234
-		writeNormalShort(converted, textures[i].always1234);
+		From::writeShort(converted, textures[i].always1234);
 	}
-	fclose(converted);
 }
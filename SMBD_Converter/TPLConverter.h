@@ -1,3 +1,10 @@
 #pragma once
 
-void parseTPL(char* filename);
\ No newline at end of file
+#include "ConversionContext.h"
+
+// Converts a tpl file to the other game and writes it next to the original (.smb2/.smbd)
+void parseTPL(char* filename);
+
+// Converts the tpl in context->input into context->output
+// Returns 0 on success or -1 on error
+int convertTPL(ConversionContext *context);
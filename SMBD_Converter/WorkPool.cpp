@@ -0,0 +1,193 @@
+#include "WorkPool.h"
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+// Pool and queue of the worker running on this thread (NULL/-1 outside of a pool)
+static thread_local WorkPool *currentPool = NULL;
+static thread_local int currentWorker = -1;
+
+static bool takeFront(WorkQueue *queue, WorkItem *item) {
+	std::lock_guard<std::mutex> guard(queue->lock);
+	if (queue->tasks.empty()) {
+		return false;
+	}
+	*item = std::move(queue->tasks.front());
+	queue->tasks.pop_front();
+	return true;
+}
+
+// Newest task of group in queue
+static bool takeGroup(WorkQueue *queue, WorkGroup *group, WorkItem *item) {
+	std::lock_guard<std::mutex> guard(queue->lock);
+	for (size_t i = queue->tasks.size(); i-- > 0;) {
+		if (queue->tasks[i].group == group) {
+			*item = std::move(queue->tasks[i]);
+			queue->tasks.erase(queue->tasks.begin() + i);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Own queue first, then the others starting with the next worker
+// With a group only that group's tasks are taken
+static bool findWork(WorkPool *pool, int worker, WorkGroup *group, WorkItem *item) {
+	int count = (int)pool->queues.size();
+	for (int i = 0; i < count; ++i) {
+		WorkQueue *queue = pool->queues[(worker + i) % count];
+		if (group == NULL ? takeFront(queue, item) : takeGroup(queue, group, item)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Any task (group NULL) or only the group's
+static bool hasQueuedWork(WorkPool *pool, WorkGroup *group) {
+	for (size_t i = 0; i < pool->queues.size(); ++i) {
+		std::lock_guard<std::mutex> guard(pool->queues[i]->lock);
+		const std::deque<WorkItem> &tasks = pool->queues[i]->tasks;
+		for (size_t j = 0; j < tasks.size(); ++j) {
+			if (group == NULL || tasks[j].group == group) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void runItem(WorkPool *pool, WorkItem *item) {
+	item->task();
+	item->task = nullptr;
+
+	bool notify = (item->group != NULL && --item->group->pending == 0);
+	if (--pool->pending == 0) {
+		notify = true;
+	}
+	if (notify) {
+		std::lock_guard<std::mutex> guard(pool->idleLock);
+		pool->done.notify_all();
+	}
+}
+
+static void runWorker(WorkPool *pool, int worker) {
+	currentPool = pool;
+	currentWorker = worker;
+
+	WorkItem item;
+	while (true) {
+		if (findWork(pool, worker, NULL, &item)) {
+			runItem(pool, &item);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(pool->idleLock);
+		if (pool->shutdown) {
+			return;
+		}
+		// Tasks are counted before they are queued, so only sleep once nothing is left to find
+		if (!hasQueuedWork(pool, NULL)) {
+			pool->idle.wait(guard);
+		}
+	}
+}
+
+WorkPool* createWorkPool(int threadCount) {
+	if (threadCount <= 0) {
+		threadCount = (int)std::thread::hardware_concurrency();
+		if (threadCount <= 0) {
+			threadCount = 1;
+		}
+	}
+
+	WorkPool *pool = new WorkPool;
+	pool->pending = 0;
+	pool->nextQueue = 0;
+	pool->shutdown = false;
+	for (int i = 0; i < threadCount; ++i) {
+		pool->queues.push_back(new WorkQueue);
+	}
+	for (int i = 0; i < threadCount; ++i) {
+		pool->threads.push_back(std::thread(runWorker, pool, i));
+	}
+	return pool;
+}
+
+void destroyWorkPool(WorkPool *pool) {
+	waitWorkPool(pool);
+	{
+		std::lock_guard<std::mutex> guard(pool->idleLock);
+		pool->shutdown = true;
+		pool->idle.notify_all();
+	}
+	for (size_t i = 0; i < pool->threads.size(); ++i) {
+		pool->threads[i].join();
+	}
+	for (size_t i = 0; i < pool->queues.size(); ++i) {
+		delete pool->queues[i];
+	}
+	delete pool;
+}
+
+static void queueItem(WorkPool *pool, WorkTask task, WorkGroup *group) {
+	int count = (int)pool->queues.size();
+	int queue = (currentPool == pool) ? currentWorker : (int)(pool->nextQueue++ % count);
+
+	++pool->pending;
+	if (group != NULL) {
+		++group->pending;
+	}
+	{
+		WorkItem item;
+		item.task = std::move(task);
+		item.group = group;
+		std::lock_guard<std::mutex> guard(pool->queues[queue]->lock);
+		pool->queues[queue]->tasks.push_back(std::move(item));
+	}
+	std::lock_guard<std::mutex> guard(pool->idleLock);
+	pool->idle.notify_one();
+	// Group waiters help with new tasks too
+	pool->done.notify_all();
+}
+
+void addWork(WorkPool *pool, WorkTask task) {
+	queueItem(pool, std::move(task), NULL);
+}
+
+void waitWorkPool(WorkPool *pool) {
+	std::unique_lock<std::mutex> guard(pool->idleLock);
+	while (pool->pending != 0) {
+		pool->done.wait(guard);
+	}
+}
+
+void initWorkGroup(WorkGroup *group) {
+	group->pending = 0;
+}
+
+void addGroupWork(WorkPool *pool, WorkGroup *group, WorkTask task) {
+	queueItem(pool, std::move(task), group);
+}
+
+void waitWorkGroup(WorkPool *pool, WorkGroup *group) {
+	int worker = (currentPool == pool) ? currentWorker : 0;
+
+	WorkItem item;
+	while (group->pending != 0) {
+		if (findWork(pool, worker, group, &item)) {
+			runItem(pool, &item);
+			continue;
+		}
+
+		// The rest of the group is running on other workers
+		std::unique_lock<std::mutex> guard(pool->idleLock);
+		if (group->pending != 0 && !hasQueuedWork(pool, group)) {
+			pool->done.wait(guard);
+		}
+	}
+}
+
+int workPoolThreadCount(const WorkPool *pool) {
+	return (int)pool->threads.size();
+}
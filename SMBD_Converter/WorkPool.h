@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> WorkTask;
+
+// Tasks that are waited on together (from inside another task)
+typedef struct {
+	std::atomic<int> pending;
+}WorkGroup;
+
+typedef struct {
+	WorkTask task;
+	// NULL if the task isn't part of a group
+	WorkGroup *group;
+}WorkItem;
+
+// Tasks waiting on one worker
+typedef struct {
+	std::mutex lock;
+	std::deque<WorkItem> tasks;
+}WorkQueue;
+
+// Work-stealing thread pool
+// Every worker has its own queue and takes from the front of it, idle workers steal from the front of the others
+// Queue tasks in the order they should run (ex. largest first) and they are spread round robin over the workers
+typedef struct {
+	std::vector<std::thread> threads;
+	std::vector<WorkQueue*> queues;
+
+	// Tasks queued or running
+	std::atomic<int> pending;
+	// Next queue for tasks added from outside the pool
+	std::atomic<uint32_t> nextQueue;
+
+	// Sleeping workers wait on this for new tasks/shutdown
+	std::mutex idleLock;
+	std::condition_variable idle;
+	// Waiters wait on this for pending (or a group's pending) to reach 0 or for new tasks
+	std::condition_variable done;
+	bool shutdown;
+}WorkPool;
+
+// Starts a pool with the given number of threads (0 = one per hardware thread)
+WorkPool* createWorkPool(int threadCount);
+
+// Waits for every task and stops the threads
+void destroyWorkPool(WorkPool *pool);
+
+// Queues a task (onto the current worker's queue when called from a task)
+void addWork(WorkPool *pool, WorkTask task);
+
+// Blocks until every queued task has finished
+void waitWorkPool(WorkPool *pool);
+
+void initWorkGroup(WorkGroup *group);
+
+// Queues a task as part of group
+void addGroupWork(WorkPool *pool, WorkGroup *group, WorkTask task);
+
+// Runs the group's tasks on this thread until all of them have finished (others may be stealing them)
+// Safe to call from inside a task since the worker keeps working instead of blocking
+void waitWorkGroup(WorkPool *pool, WorkGroup *group);
+
+int workPoolThreadCount(const WorkPool *pool);